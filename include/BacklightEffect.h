@@ -0,0 +1,79 @@
+#ifndef BACKLIGHT_EFFECT_H
+#define BACKLIGHT_EFFECT_H
+
+/*
+ * Per LED backlight effects, as small programs for a stack machine.
+ * The program runs once for every LED and every frame. Values are fractions in 16 bit fixed point (65535 = 1.0,
+ * a whole turn for positions and phases), add, sub and mul saturate at +-256.0. What is left on the stack is the
+ * brightness of the LED.
+ *
+ * Format, as hex text (spaces allowed): version (1), period in 10 ms (2 bytes, little endian), then the code:
+ *   01 n  push n / 255        02 pos    position of the LED on the strip    03 time    phase of the period
+ *   04 second  position of the second hand in the minute                  12 unit    width of one LED
+ *   05 add    06 sub    07 mul    08 min    09 max    0E step (a < b ? 1 : 0)
+ *   0A frac (wrap into a turn)    0B inv (1 - a)    0C tri (triangle)    0D wave (smooth pulse)
+ *   0F dup    10 swap    11 hue (pops the colour of the LED, default: the colour of the pattern)
+ * Example, a comet going round every 1.5 s: "019600 03 02 06 0A 0B 0F 07 0F 07" = (1 - frac(time - pos))^4.
+ */
+
+#include <stdint.h>
+
+class BacklightEffect
+{
+public:
+  enum opcodes
+  {
+    op_push = 0x01,
+    op_pos,
+    op_time,
+    op_second,
+    op_add,
+    op_sub,
+    op_mul,
+    op_min,
+    op_max,
+    op_frac,
+    op_inv,
+    op_tri,
+    op_wave,
+    op_step,
+    op_dup,
+    op_swap,
+    op_hue,
+    op_unit,
+    num_opcodes
+  };
+
+  struct Pixel
+  {
+    uint16_t level; // 0..65535
+    int32_t hue;    // 0..65535, -1 = colour of the pattern
+  };
+
+  // Parses and checks a program. The stack depth is checked here, so eval() needs no checks.
+  bool load(const char *hex);
+  bool isLoaded() { return code_length > 0; }
+  uint32_t getPeriodMs() { return period_10ms * 10UL; }
+  uint8_t getCodeLength() { return code_length; }
+
+  // LED led of count, time = phase of the period, second = position of the second hand.
+  Pixel eval(uint16_t led, uint16_t count, uint16_t time, uint16_t second) const;
+
+  // The built-in effects: a chasing LED, a comet and a second hand.
+  static const char chase_program[];
+  static const char comet_program[];
+  static const char seconds_program[];
+
+  static const uint8_t version = 1;
+  static const uint8_t max_code = 48;
+  static const uint8_t max_stack = 8;
+  static const int32_t max_value = 1L << 24; // 256.0
+  static const uint8_t max_text = 160; // longest program text, with a space between all bytes, and the '\0'
+
+private:
+  uint8_t code[max_code];
+  uint8_t code_length = 0;
+  uint16_t period_10ms = 0;
+};
+
+#endif // BACKLIGHT_EFFECT_H
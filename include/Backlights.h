@@ -12,12 +12,25 @@
  * as the pixel index, no mapping required.
  *
  * Otherwise, class Backlights behaves exactly as Adafruit_NeoPixel does.
+ *
+ * The patterns don't call show(), which blocks while the data is on the wire. Their frames go through sendFrame():
+ * a frame equal to the last one sent is skipped, and on the ESP32 the RMT peripheral sends the data, so loop()
+ * doesn't wait for it. Animated patterns are computed at most BACKLIGHT_MAX_FPS times per second.
+ *
+ * The pixels keep the full colours, setBrightness() doesn't scale them like in Adafruit_NeoPixel. sendFrame() makes
+ * a 16 bit frame of them: gamma corrected colour times brightness. Dim frames (brightness up to BACKLIGHT_DITHER_LEVEL)
+ * are sent BACKLIGHT_REFRESH_HZ times per second by a timer, with temporal dithering, so dim colours and slow fades
+ * don't step. The timer runs only then, brighter frames are rounded to 8 bits and sent once.
  */
 #include <stdint.h>
 #include <math.h>
 #include "StoredConfig.h"
+#include "Waveform.h"
+#include "BacklightEffect.h"
 #include <Adafruit_NeoPixel.h>
 
+class Clock;
+
 class Backlights : public Adafruit_NeoPixel
 {
 public:
@@ -34,13 +47,32 @@ public:
     rainbow,
     pulse,
     breath,
+    chase,   // the effects run a BacklightEffect program per LED
+    comet,
+    seconds, // synced to the clock
+    custom,  // loaded from BACKLIGHT_EFFECT_FILE or MQTT
     num_patterns
   };
   const static String patterns_str[num_patterns];
 
-  void begin(StoredConfig::Config::Backlights *config_);
+  // clock_: for the second hand of the effects, nullptr runs it from millis().
+  void begin(StoredConfig::Config::Backlights *config_, Clock *clock_ = nullptr);
   void loop();
 
+  // Loads the program of the custom effect (see BacklightEffect.h) and saves it to BACKLIGHT_EFFECT_FILE.
+  bool setCustomEffect(const char *hex);
+  // Time to compute the last effect frame, in microseconds.
+  uint32_t getEffectFrameUs() { return effect_frame_us; }
+
+  // Frames given to the output, frames skipped because they were equal to the last one, and frames sent to the LEDs
+  // (more than given to the output while dithering).
+  uint32_t getFramesSent() { return frames_sent; }
+  uint32_t getFramesSkipped() { return frames_skipped; }
+  uint32_t getRefreshes() { return refreshes; }
+
+  // Hides Adafruit_NeoPixel::setBrightness(): the brightness is applied in the output stage. 0 is dark, 255 full.
+  void setBrightness(uint8_t b) { level = b == 0 ? 0 : b + 1; }
+
   void togglePower()
   {
     off = !off;
@@ -113,13 +145,57 @@ private:
   // Pattern configs, get backed up.
   StoredConfig::Config::Backlights *config;
 
+  void applyIntensity(); // setBrightness() for the intensity, or BACKLIGHT_DIMMED_INTENSITY while dimmed
+
+  // LED output
+  void sendFrame();
+  static uint32_t hashBytes(const void *data, uint16_t length);
+  void beginOutput();
+  void startRefreshTimer();
+  static void refreshCallback(void *arg);
+  void refreshOutput();
+  bool isOutputReady();
+  void writeFrame(const uint8_t *frame);
+  void showFrame(const uint8_t *frame);
+  bool rmt_output = false;    // false: RMT not available, frames are sent with show()
+  bool output_timer = false;  // the refresh timer for dithering exists, else refreshOutput() runs from loop()
+  volatile bool timer_running = false; // refreshOutput() runs from the timer now, not from loop()
+  struct esp_timer *refresh_timer = nullptr; // esp_timer_handle_t
+  uint16_t level = 256;       // brightness of the patterns, 0..256
+  uint32_t sent_hash = 0;     // hash of the last 16 bit frame, 0 = none
+  bool sent_dither = false;   // the last frame is dithered
+  uint32_t output_hash = 0;   // hash of the last frame sent to the LEDs
+  uint32_t sent_us = 0;       // micros() when the last frame was started
+  uint32_t last_frame_ms = 0; // millis() when the pattern was last computed
+  uint32_t frames_sent = 0;
+  uint32_t frames_skipped = 0;
+  uint32_t refreshes = 0;
+  volatile bool frame_ready = false; // next_frame wasn't taken by refreshOutput() yet
+  bool next_dither = false;          // next_frame is dim, it is dithered
+  bool output_dither = false;        // output_frame is dithered
+  bool dithering = false;            // the output has dithered values, it changes at every refresh
+  uint16_t next_frame[NUM_BACKLIGHT_LEDS * 3];   // from sendFrame(), 0..65535 per colour
+  uint16_t output_frame[NUM_BACKLIGHT_LEDS * 3]; // the one refreshOutput() sends
+  uint8_t dither_error[NUM_BACKLIGHT_LEDS * 3] = {}; // fraction left over from the last refresh
+
   // Pattern methods
+  PhaseAccumulator wave; // phase of the animated patterns, moved on by the time since their last frame
   void testPattern();
   void rainbowPattern();
   void pulsePattern();
   void breathPattern();
+  void effectPattern();
+  void selectEffect();
+
+  Clock *clock = nullptr;
+  BacklightEffect effect;        // the running effect
+  BacklightEffect custom_effect; // loaded from the file at the first use
+  bool custom_effect_read = false;
+  uint32_t effect_frame_us = 0;
+  bool effect_budget_warned = false;
 
   const uint32_t test_ms_delay = 250;
+  const uint32_t frame_interval_ms = 1000 / BACKLIGHT_MAX_FPS;
 };
 
 extern Backlights backlights;
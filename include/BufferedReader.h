@@ -0,0 +1,105 @@
+#ifndef BUFFERED_READER_H
+#define BUFFERED_READER_H
+
+/*
+ * Buffered reading of an image (a part of a file), for the image decoders.
+ * Instead of one file system call per header field and per row, the data is read in chunks. Each read ends at a
+ * multiple of the chunk size in the file, so LittleFS reads whole blocks. The header fields and rows are then taken
+ * from the buffer: the first read brings the header, the palette and the first rows.
+ */
+
+#include <FS.h>
+#include <stdint.h>
+#include <string.h>
+
+class BufferedReader
+{
+public:
+  // Reads the file from position start to end. The buffer must hold chunk_size + max_take bytes.
+  BufferedReader(fs::File &file_, uint32_t start_, uint32_t end_, uint8_t *buffer_, uint32_t chunk_size_, uint32_t max_take_)
+      : file(file_), start(start_), end(end_), buffer(buffer_), chunk_size(chunk_size_), max_take(max_take_),
+        buffer_pos(start_) {}
+
+  // The next length bytes (up to max_take) in the buffer, valid until the next call. nullptr past the end.
+  const uint8_t *take(uint32_t length)
+  {
+    if (filled - head < length && !fill(length))
+      return nullptr;
+    const uint8_t *data = buffer + head;
+    head += length;
+    return data;
+  }
+  bool read(void *dest, uint32_t length)
+  {
+    const uint8_t *data = take(length);
+    if (data == nullptr)
+      return false;
+    memcpy(dest, data, length);
+    return true;
+  }
+  // Little endian, like the ESP32. Past the end all bits are set, like File::read() returning -1 per byte.
+  uint8_t read8()
+  {
+    const uint8_t *data = take(1);
+    return data != nullptr ? data[0] : 0xFF;
+  }
+  uint16_t read16()
+  {
+    uint16_t value = 0xFFFF;
+    read(&value, sizeof(value));
+    return value;
+  }
+  uint32_t read32()
+  {
+    uint32_t value = 0xFFFFFFFF;
+    read(&value, sizeof(value));
+    return value;
+  }
+
+  // Position relative to start. Nothing is read if it is in the buffer already.
+  void seek(uint32_t position)
+  {
+    uint32_t target = start + position;
+    if (target >= buffer_pos && target <= buffer_pos + filled)
+    {
+      head = target - buffer_pos;
+      return;
+    }
+    buffer_pos = target;
+    filled = head = 0;
+  }
+
+private:
+  // Keeps the bytes not taken yet and reads up to the first chunk boundary after the requested ones.
+  bool fill(uint32_t length)
+  {
+    if (length > max_take)
+      return false;
+    uint32_t kept = filled - head;
+    memmove(buffer, buffer + head, kept);
+    buffer_pos += head;
+    head = 0;
+    filled = kept;
+
+    uint32_t read_from = buffer_pos + filled;
+    uint32_t read_to = (buffer_pos + length + chunk_size - 1) / chunk_size * chunk_size;
+    if (read_to > end)
+      read_to = end;
+    if (read_to < buffer_pos + length)
+      return false; // past the end
+    if (file.position() != read_from)
+      file.seek(read_from);
+    filled += file.read(buffer + filled, read_to - read_from);
+    return filled >= length;
+  }
+
+  fs::File &file;
+  const uint32_t start, end;
+  uint8_t *const buffer;
+  const uint32_t chunk_size, max_take;
+  uint32_t buffer_pos; // file position of buffer[0]
+  uint32_t filled = 0; // bytes in the buffer
+  uint32_t head = 0;   // next byte to take
+};
+
+#endif // BUFFERED_READER_H
@@ -32,6 +32,8 @@ public:
   // Helper functions
   // Sets just the one digit by digit number
   void setDigit(uint8_t digit, bool update_ = true);
+  // Selects all digits of the map at once (bit 0 is SECONDS_ONES), they all get the same data. Also for the clocks with one CS pin per display.
+  void setDigits(uint8_t map);
   void enableDigitCSPins(uint8_t digit);
   void disableDigitCSPins(uint8_t digit);
 
@@ -57,7 +59,7 @@ public:
   void reclaimPins();
 
 private:
-  uint8_t digits_map;
+  uint8_t digits_map = 0;
   const uint8_t all_on = 0x3F;
   const uint8_t all_off = 0x00;
 };
@@ -19,10 +19,11 @@ public:
   Clock() : loop_time(0), local_time(0), time_valid(false), config(NULL) {}
 
   // The global WiFi from WiFi.h must already be .begin()'d before calling Clock::begin()
-  void begin(StoredConfig::Config::Clock *config_);
+  void begin(StoredConfig::Config::Clock *config_, StoredConfig::Config::Rtc *rtc_config_);
   void loop();
 
-  // Calls NTPClient::getEpochTime() or RTC::get() as appropriate
+  // Returns the RTC time, corrected by the learned drift. When NTP is due, it sends the request too, and pollNtp()
+  // applies the answer on a later loop().
   // This has to be static to pass to TimeLib::setSyncProvider.
   static time_t syncProvider();
 
@@ -31,6 +32,19 @@ public:
   static void handleNtpFailure();
   static void updateNtpInterval();
   static uint32_t getCurrentNtpInterval() { return current_ntp_interval_ms; }
+  // Syncs with NTP now, e.g. when WiFi came up after the clock was started with the RTC time (FAST_BOOT).
+  static void requestNtpSync();
+  static bool isNtpSynced() { return ntp_synced; }
+
+  // RTC drift, learned at the NTP syncs. Calibrated: the corrected RTC was close to NTP at the last sync, NTP is then
+  // asked only every ntp_interval_calibrated_ms.
+  static int32_t getRtcDriftPpb() { return rtc_config ? rtc_config->drift_ppb : 0; }
+  static uint8_t getRtcDriftSyncs() { return rtc_config ? rtc_config->drift_syncs : 0; }
+  static bool isRtcDriftCalibrated() { return rtc_drift_calibrated; }
+  // The RTC was set or its drift learned. The config is then saved by main.cpp in free time, not in the first loop of
+  // the second: an NVS write can take longer than the loop.
+  static bool isConfigSavePending() { return config_save_pending; }
+  static void configSaved() { config_save_pending = false; }
 
   // Set preferred hour format. true = 12hr, false = 24hr
   void setTwelveHour(bool th) { config->twelve_hour = th; }
@@ -102,16 +116,57 @@ public:
   uint8_t getSecondsTens() { return getSecond() / 10; }
   uint8_t getSecondsOnes() { return getSecond() % 10; }
 
+  // The digit values (like the helpers above, indexed by SECONDS_ONES ... HOURS_TENS) shown at the next second,
+  // and the time left until then. Used to load the images of the next second ahead.
+  // After an NTP sync the time left is exact to a few ms, so the main loop can wake up when the second changes.
+  void getNextSecondDigits(uint8_t next_digits[NUM_DIGITS]);
+  uint32_t getMillisToNextSecond();
+
+  // delay(), but while an NTP answer or the RTC's next second is awaited, they are picked up within a ms.
+  void idle(uint32_t ms);
+
   time_t loop_time, local_time;
 
 private:
   bool time_valid;
   StoredConfig::Config::Clock *config;
+  uint32_t millis_at_second = 0; // millis() when loop() saw the current second begin
+
+  static void pollNtp();
+  static void alignToSecond();
+
+  // RTC drift: the RTC is set to NTP on the second, and at later syncs the time of its next second is measured against
+  // NTP. The drift since it was set goes into the stored config, and corrects the RTC time between the syncs.
+  static StoredConfig::Config::Rtc *rtc_config;
+  static bool rtc_drift_calibrated;
+  static bool config_save_pending;
+  static time_t getRtcTime();
+  static int32_t getRtcGainedMs(time_t rtc_time);
+  static time_t correctRtcTime(time_t rtc_time);
+  static void startRtcEdge(time_t rtc_time, bool for_drift);
+  static void pollRtcEdge();
+  static void measureRtcDrift(time_t rtc_second, uint32_t edge_millis);
+  static void anchorToRtc(time_t rtc_second, uint32_t edge_millis);
+  static bool rtc_edge_pending;   // waiting for the RTC's next second
+  static bool rtc_edge_for_drift; // true: measure the drift (after NTP), false: the model follows the RTC (no NTP)
+  static time_t rtc_edge_value;   // RTC time before its next second
+  static uint32_t rtc_edge_start, rtc_edge_last_read;
+  static uint32_t rtc_edge_expected; // millis() when the model expects the RTC's next second
+  static uint32_t rtc_edge_wake;     // millis() from when the RTC is read again
+
+  // Millisecond model of the time, set by each NTP answer: the UTC second model_second began at millis() model_millis.
+  // With it, loop() changes the second on the real second boundary, not up to a second later like TimeLib.
+  static bool model_valid;
+  static time_t model_second;
+  static uint32_t model_millis;
+  static bool align_pending;   // set TimeLib to the model at the next second
+  static bool rtc_set_pending; // set the RTC to NTP at the next second
 
   // Static variables needed for syncProvider()
   static WiFiUDP ntpUDP;
   static NTPClient ntpTimeClient;
   static uint32_t millis_last_ntp;
+  static bool ntp_synced; // at least one successful NTP sync since boot
 
   // Adaptive NTP sync intervals
   static uint32_t current_ntp_interval_ms;
@@ -124,6 +179,18 @@ private:
   const static uint32_t ntp_interval_stable_ms = 3600000; // 1 hour - stable operation
   const static uint32_t ntp_interval_error_ms = 600000;   // 10 min - after errors
   const static uint32_t ntp_interval_max_ms = 7200000;    // 2 hours - maximum interval
+  const static uint32_t ntp_interval_calibrated_ms = 21600000; // 6 hours - RTC drift is known and corrected
+  const static uint32_t rtc_read_interval_ms = 3600000;        // 1 hour - TimeLib takes the RTC time at least this often
+
+  // RTC drift constants
+  const static int32_t rtc_drift_min_baseline_s = 3600; // measure the drift only 1 hour or more after the RTC was set
+  const static int32_t rtc_drift_max_ppb = 500000;      // 500 ppm, more is a wrong RTC time, not drift
+  const static int32_t rtc_offset_max_ms = 500;         // set the RTC again when it is this far off NTP
+  const static int32_t rtc_residual_max_ms = 100;       // calibrated, when the corrected RTC is this close to NTP
+  const static uint32_t rtc_edge_max_gap_ms = 50;       // longer between two RTC reads is too inexact for the second
+  const static uint32_t rtc_edge_timeout_ms = 2500;
+  const static uint32_t rtc_edge_early_ms = 20; // start reading the RTC this long before its second is expected
+  const static uint32_t rtc_anchor_max_ms = 10; // without NTP, the model follows the RTC when their seconds are further apart
 };
 
 extern Clock uclock;
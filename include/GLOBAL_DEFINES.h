@@ -54,8 +54,39 @@
 #define MQTT_RECONNECT_WAIT_SEC 30      // How long to wait between retries to connect to broker
 #define MQTT_REPORT_STATUS_EVERY_SEC 15 // How often report status to MQTT Broker
 
+// ************ Loop profiler config *********************
+#define LOOP_PROFILER_SAMPLES 256      // Times kept per stage of the main loop, for median and 99th percentile
+#define LOOP_PROFILER_REPORT_SEC 60    // How often the loop profile is sent to MQTT, min/max start over with each report
+
 // ************ Backlight config *********************
 #define DEFAULT_BL_RAINBOW_DURATION_SEC 8
+#ifndef BACKLIGHT_MAX_FPS
+#define BACKLIGHT_MAX_FPS 50     // Animated backlight patterns are computed and sent at most this often per second
+#endif
+#define BACKLIGHT_EFFECT_FILE "/backlight_effect.txt" // Program of the "Custom" backlight effect, as hex text
+#define BACKLIGHT_EFFECT_BUDGET_US 500 // An effect frame taking longer is reported on the serial monitor
+#define BACKLIGHT_REFRESH_HZ 400 // The LEDs are refreshed this often while a dim frame is dithered (34 LEDs take 1.3 ms)
+#define BACKLIGHT_DITHER_LEVEL 32 // Frames with a brightness up to this (of 256: intensity 4 and lower, dimmed at night) are dithered
+#define BACKLIGHTS_RMT_CHANNEL RMT_CHANNEL_0 // RMT channel sending the data to the LEDs (ESP32)
+
+// ************ Display image config *********************
+#define MAX_CLOCK_FACES 24 // 24 at most: files are numbered face * 10 + digit in a uint8_t, face 25 would need 250..259
+#define GLYPH_CACHE_MIN_FREE_PSRAM (256 * 1024) // Boards with PSRAM: keep at least this much PSRAM free, else the glyph cache is dropped
+#define IMAGE_PREFETCH_BUFFERS 2                // Extra image buffers (64 kB each) for the digits changing at the next second, not with GLYPH_CACHE
+#define IMAGE_PREFETCH_MIN_FREE_HEAP (80 * 1024) // Keep at least this much internal RAM free, else prefetch buffers are released
+#define IMAGE_READ_CHUNK 4096                   // Images are read in chunks up to multiples of this (the LittleFS block size)
+#define DIGIT_TRANSITION_MS 300                 // Duration of a digit transition. Must be over well before the next second
+#define DIGIT_TRANSITION_MAX_FRAMES 12          // Frames per transition, less if the displays can't be updated that fast
+#define DIGIT_TRANSITION_LOOP_BUDGET_MS 15      // Max time spent on transition frames per loop()
+
+// The glyph cache keeps all digits of the face in PSRAM. Not in band mode (TFT_BAND_ROWS), which keeps no image in memory.
+#if defined(BOARD_HAS_PSRAM) && !defined(TFT_BAND_ROWS)
+#define GLYPH_CACHE
+#endif
+// Transitions need both digits in memory for every frame, so they run on the glyph cache only.
+#if defined(DIGIT_TRANSITION) && !defined(GLYPH_CACHE)
+#undef DIGIT_TRANSITION
+#endif
 
 // ************ Hardware definitions *********************
 
@@ -0,0 +1,100 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+/*
+ * Time measurement of the stages of the main loop.
+ * Every stage keeps its last LOOP_PROFILER_SAMPLES times in a ring buffer, for the median and the 99th percentile,
+ * and its minimum and maximum since the last report. Shown with the serial command "diag" and sent to MQTT.
+ * The phases of the start-up are kept too (always, also without LOOP_PROFILER) and printed when they end.
+ */
+
+#include "GLOBAL_DEFINES.h"
+
+class LoopProfiler
+{
+public:
+  enum stage_t
+  {
+    wifi,
+    mqtt,
+    buttons,
+    menu,
+    backlights,
+    clock,
+    display,
+    load_image,
+    free_time,
+    total,
+    num_stages
+  };
+  static const char *stage_str[num_stages];
+
+  struct Stats
+  {
+    uint32_t min, max, p50, p99; // microseconds
+    uint16_t samples;
+  };
+
+  // Phases of the start-up. With FAST_BOOT the network phases end in loop(), after the time is shown.
+  enum boot_phase_t
+  {
+    boot_config,
+    boot_peripherals,
+    boot_displays,
+    boot_wifi,
+    boot_clock,
+    boot_mqtt,
+    boot_geoloc,
+    boot_first_digits,
+    boot_ntp, // until the first successful NTP sync
+    num_boot_phases
+  };
+  static const char *boot_phase_str[num_boot_phases];
+
+  void bootPhaseStart(boot_phase_t phase) { boot_start[phase] = millis(); }
+  void bootPhaseDone(boot_phase_t phase);
+  bool isBootPhaseStarted(boot_phase_t phase) { return boot_start[phase] != 0; }
+  bool isBootPhaseDone(boot_phase_t phase) { return boot_done[phase] != 0; }
+  uint32_t getBootPhaseMs(boot_phase_t phase) { return boot_done[phase] - boot_start[phase]; }
+  // Start and duration of each phase, in ms since power-on.
+  void printBootReport(Print &out);
+
+#ifdef LOOP_PROFILER
+  void start(stage_t stage) { started[stage] = micros(); }
+  void stop(stage_t stage) { record(stage, micros() - started[stage]); }
+  void record(stage_t stage, uint32_t us);
+
+  Stats getStats(stage_t stage);
+  uint32_t getLoops() { return loops; }
+  uint32_t getWindowMs() { return millis() - window_start; }
+  // Starts a new min/max window, the ring buffers are kept.
+  void resetWindow();
+  void printReport(Print &out);
+
+private:
+  // Times are stored in 16 bit: up to 32767 us exact, above in ms with the top bit set. The order is kept, so the
+  // stored values can be sorted as they are.
+  static uint16_t encode(uint32_t us) { return us < 0x8000 ? us : 0x8000 | min<uint32_t>(us / 1000, 0x7FFF); }
+  static uint32_t decode(uint16_t value) { return value & 0x8000 ? (value & 0x7FFF) * 1000UL : value; }
+
+  uint32_t started[num_stages] = {};
+  uint16_t samples[num_stages][LOOP_PROFILER_SAMPLES];
+  uint16_t count[num_stages] = {}; // valid samples, up to LOOP_PROFILER_SAMPLES
+  uint16_t next[num_stages] = {};  // ring buffer position
+  uint32_t window_min[num_stages];
+  uint32_t window_max[num_stages];
+  uint32_t window_start = 0;
+  uint32_t loops = 0;
+#else
+  void start(stage_t stage) {}
+  void stop(stage_t stage) {}
+#endif // LOOP_PROFILER
+
+private:
+  uint32_t boot_start[num_boot_phases] = {}; // millis(), 0 = not started
+  uint32_t boot_done[num_boot_phases] = {};  // millis(), 0 = not done
+};
+
+extern LoopProfiler loop_profiler;
+
+#endif // LOOP_PROFILER_H
@@ -59,6 +59,8 @@ extern char MQTTCommandPattern[];
 extern char MQTTCommandBackPattern[];
 extern bool MQTTCommandPatternReceived;
 extern bool MQTTCommandBackPatternReceived;
+extern char MQTTCommandBackEffect[];
+extern bool MQTTCommandBackEffectReceived;
 extern uint16_t MQTTCommandBackColorPhase;
 extern bool MQTTCommandBackColorPhaseReceived;
 extern uint8_t MQTTCommandGraphic;
@@ -64,6 +64,15 @@ public:
       char password[str_buffer_size];
       uint8_t WPS_connected; // Write StoredConfig::valid here when valid data is loaded.
     } wifi;
+
+    // New members go here, at the end: a config saved by an older firmware is shorter, and loads with them zeroed.
+    struct Rtc
+    {
+      int32_t drift_ppb;   // How much faster (> 0) or slower the RTC runs than NTP, in parts per billion.
+      uint32_t set_time;   // UTC time the RTC was last set to NTP. It was set on the second, the drift counts from here.
+      uint8_t drift_syncs; // NTP syncs the drift was learned from, 0 = not known yet.
+      uint8_t is_valid;    // Write StoredConfig::valid here when valid data is loaded.
+    } rtc;
   } config;
 
   const static uint8_t valid = 0x55; // neither 0x00 nor 0xFF, signaling loaded config isn't just default data.
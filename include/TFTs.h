@@ -7,6 +7,28 @@
 #include <TFT_eSPI.h>
 #include "GLOBAL_DEFINES.h"
 #include "ChipSelect.h"
+#include "BufferedReader.h"
+
+// CLK file format version 2: "C2", u8 version (2), u8 compression, u16 width, u16 height, u32 reserved,
+// u32 file offset of each row, then the rows. All values little endian. Version 1 files ("CK") are raw.
+#define CLK_V2_HEADER_SIZE 12
+#define CLK_COMPRESSION_NONE 0
+#define CLK_COMPRESSION_RLE 1
+#define CLK_COMPRESSION_PALETTE 2 // u16 colors and the RGB565 palette after the row offsets, one palette index per pixel
+
+#ifdef USE_CLK_FILES
+#define IMAGE_FILE_TYPE "CLK"
+#define IMAGE_FILE_EXTENSION "clk"
+#else
+#define IMAGE_FILE_TYPE "BMP"
+#define IMAGE_FILE_EXTENSION "bmp"
+#endif
+
+// Clock face pack: all images of all faces in one file, see tools/pack-clock-faces.py.
+// "CFPK", u8 version (1), u8 number of faces, u16 reserved, then faces * 10 index entries of
+// u32 offset (from the start of the pack) and u32 size, then the unchanged image files. Size 0 = image missing.
+#define CLOCK_FACE_PACK "/clockfaces.pak"
+#define CLOCK_FACE_PACK_MAGIC 0x4B504643 // "CFPK"
 
 class TFTs : public TFT_eSPI
 {
@@ -35,10 +57,23 @@ public:
   void begin();
   void reinit();
   void clear();
-  void showNoWifiStatus();
-  void showNoMqttStatus();
+  // Icons for the overlays: 1 bit per pixel, rows of (width + 7) / 8 bytes, the lowest bit is the leftmost pixel (XBM).
+  struct OverlayIcon
+  {
+    int16_t width, height;
+    const uint8_t *bits;
+  };
+  static const OverlayIcon icon_wifi;
+
+  // The menu, on the lower half of the hours tens display. Lines are separated by '\n'. Sent only where it changed.
+  // Optionally with an icon in the lower right corner and a progress bar (0 to 100 %, -1 for none) along the bottom.
+  void showMenu(const char *text, const OverlayIcon *icon = nullptr, int8_t progress = -1);
+  void hideMenu(); // and show the digit again
 
   void setDigit(uint8_t digit, uint8_t value, show_t show = yes);
+  // Sets all digits at once, values indexed like setDigit(). Digits changing to the same value are drawn together:
+  // the image is sent once to all their displays (11:11:11, 00:00:00).
+  void setDigits(const uint8_t values[NUM_DIGITS], show_t show = yes);
   uint8_t getDigit(uint8_t digit) { return digits[digit]; }
 
   void showAllDigits()
@@ -46,7 +81,8 @@ public:
     for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
       showDigit(digit);
   }
-  void showDigit(uint8_t digit);
+  void showDigit(uint8_t digit) { showDigits(1 << digit); }
+  void showDigits(uint8_t digit_map); // bit 0 is SECONDS_ONES, all digits of the map must have the same value
 
   // Controls the power to all displays
   void enableAllDisplays();
@@ -58,29 +94,271 @@ public:
   ChipSelect chip_select;
 
   uint8_t NumberOfClockFaces = 0;
-  void LoadNextImage();
-  void InvalidateImageInBuffer(); // force reload from Flash with new dimming settings
+  // Tells which digit values are shown at the next second and how long it is until then (see Clock). The images of the
+  // digits that change are loaded by LoadNextImage(), so the next update reads nothing from the flash.
+  void PlanPrefetch(const uint8_t next_digits[NUM_DIGITS], uint32_t ms_to_next_second);
+  void LoadNextImage(); // call in free time only
+  // Allocates the prefetch buffers (not with GLYPH_CACHE). Call once the network is up, so WiFi and MQTT got their
+  // internal RAM first. LoadNextImage() releases them again if the free heap drops below IMAGE_PREFETCH_MIN_FREE_HEAP.
+  void EnablePrefetchBuffers();
+  void InvalidateImageInBuffer(); // force reload from Flash
   void ProcessUpdatedDimming();
 
+#ifdef DIGIT_TRANSITION
+  // How a digit change is animated. "instant" switches the transitions off.
+  enum transition_t
+  {
+    instant,
+    crossfade,
+    slide,
+    flip
+  };
+  transition_t transition = transition_t(DIGIT_TRANSITION);
+#endif
+  // Draws the due frames of the running digit transitions, call every loop().
+  void RenderTransitions();
+  // Draws the last frame of all running transitions at once. Call before drawing onto the displays from outside.
+  void FinishTransitions();
+
+  // Blocks until the last image pushed by DMA is completely sent and releases the SPI bus.
+  // Must be called before the chip select is changed or anything else is drawn from outside this class.
+  void WaitForImageTransfer();
+
   String clockFaceToName(uint8_t clockFace);
   uint8_t nameToClockFace(String name);
 
 private:
+#ifdef NATIVE_BUILD
+  friend class NativeBench; // native/src/bench.cpp times the image decoder directly
+#endif
   uint8_t digits[NUM_DIGITS];
   bool TFTsEnabled = false;
 
+  // An image opened either as a single file or inside the clock face pack. Offsets in the image are relative to "offset".
+  struct ImageFile
+  {
+    fs::File file;
+    uint32_t offset;
+    uint32_t size;
+    uint8_t index;
+  };
+  struct PackEntry
+  {
+    uint32_t offset;
+    uint32_t size;
+  };
+
+  // Overlays: bitmaps which replace rows of a display. They are put into the rows while the image is sent, so a shown
+  // overlay needs no transfer of its own and the rows under it are only sent again when it comes or goes. The status
+  // overlays ("NO WiFi!", "NO MQTT!") are rendered once, the menu whenever its text, icon or progress changes. Digits
+  // with different overlays are not drawn together.
+  enum overlay_t
+  {
+    overlay_no_wifi,
+    overlay_no_mqtt,
+    overlay_menu,
+    num_overlays,
+    no_overlay = num_overlays
+  };
+  static const int16_t STATUS_OVERLAY_ROWS = 27; // font 4 is 26 pixels high
+  static const int16_t MENU_FIRST_ROW = TFT_HEIGHT / 2;
+  struct Overlay
+  {
+    int16_t first_row, rows;
+    uint16_t (*pixels)[TFT_WIDTH]; // panel byte order, DMA capable. nullptr if not rendered
+    uint32_t *row_hash;            // in the same allocation
+  };
+  Overlay Overlays[num_overlays] = {};
+  bool MenuShown = false;
+  String MenuText;
+  const OverlayIcon *MenuIcon = nullptr;
+  int8_t MenuProgress = -1;
+  overlay_t DisplayOverlay(uint8_t digit);
+  Overlay *GetOverlay(uint8_t digit_map);
+  bool RenderOverlay(overlay_t id, const char *text, const OverlayIcon *icon = nullptr, int8_t progress = -1);
+  void DrawIconAndProgress(TFT_eSPI &gfx, int16_t top, int16_t rows, const OverlayIcon *icon, int8_t progress);
+  void ReleaseOverlay(overlay_t id);
+  void DrawOverlay(uint8_t digit);
+  uint16_t SendRows(uint8_t digit_map, int8_t buffer, const Overlay *overlay, int16_t first, int16_t end);
+  uint32_t SourceRowHash(int8_t buffer, const Overlay *overlay, int16_t row);
+  void PushImageRows(uint16_t (*pixels)[TFT_WIDTH], int16_t first_row, int16_t rows, uint8_t buffer);
+  const uint16_t *OverlayRow(const Overlay *overlay, int16_t row)
+  {
+    if (overlay == nullptr || row < overlay->first_row || row >= overlay->first_row + overlay->rows)
+      return nullptr;
+    return overlay->pixels[row - overlay->first_row];
+  }
+
   bool FileExists(const char *path);
   int8_t CountNumberOfClockFaces();
-  bool LoadImageIntoBuffer(uint8_t file_index);
-  void DrawImage(uint8_t file_index);
-  uint16_t read16(fs::File &f);
-  uint32_t read32(fs::File &f);
+  bool OpenClockFacePack();
+  bool OpenImageFile(uint8_t file_index, ImageFile &img);
+  bool DecodeImageFile(uint8_t file_index, uint16_t (*image)[TFT_WIDTH]);
+  bool DecodeImageData(ImageFile &img, uint16_t (*image)[TFT_WIDTH]);
+#ifndef TFT_BAND_ROWS
+  bool LoadImageIntoBuffer(uint8_t file_index, uint8_t buffer);
+  uint8_t PrepareImage(uint8_t file_index);
+  int8_t FindImageBuffer(uint8_t file_index);
+  uint8_t FindFreeImageBuffer();
+  int8_t FindPrefetchBuffer();
+  bool IsPrefetched(uint8_t file_index);
+  void AllocateImageBuffers();
+  void ReleasePrefetchBuffer();
+  void DrawImage(uint8_t digit_map, uint8_t buffer);
+  uint16_t *ImageRow(uint16_t (*image)[TFT_WIDTH], int16_t row) { return image[row]; }
+#else
+  uint16_t *ImageRow(uint16_t (*image)[TFT_WIDTH], int16_t row) { return image != nullptr ? image[row] : BandRow(row); }
+#endif
+#ifdef USE_CLK_FILES
+  uint16_t ClkPixel(uint8_t PixL, uint8_t PixM);
+#endif
+  // Buffer of the BufferedReader in DecodeImageData(). The largest part taken at once is the palette of an 8 bit BMP.
+  static const uint32_t IMAGE_READ_MAX_TAKE = 256 * 4;
+  alignas(4) static uint8_t ImageReadBuffer[IMAGE_READ_CHUNK + IMAGE_READ_MAX_TAKE];
+
+  fs::File PackFile; // stays open while the pack is used
+  PackEntry PackIndex[MAX_CLOCK_FACES * 10];
+  uint8_t NumberOfPackedFaces = 0;
+
+#ifndef TFT_BAND_ROWS
+  // Image buffers hold the undimmed pixels already in the byte order of the panel (MSB first), so they can be sent as they are,
+  // either by pushImage() or by DMA. With TFT_USE_DMA a second buffer is allocated, so the next image can be decoded
+  // while the previous one is still streamed out to its display. Up to IMAGE_PREFETCH_BUFFERS more hold prefetched digits.
+#ifdef GLYPH_CACHE
+  static const uint8_t MAX_IMAGE_BUFFERS = 2; // the digits of the next second come from the glyph cache
+#else
+  static const uint8_t MAX_IMAGE_BUFFERS = 2 + IMAGE_PREFETCH_BUFFERS;
+#endif
+  alignas(4) static uint16_t UnpackedImageBuffer[TFT_HEIGHT][TFT_WIDTH];
+  uint16_t (*ImageBuffer[MAX_IMAGE_BUFFERS])[TFT_WIDTH] = {UnpackedImageBuffer};
+  uint8_t FileInBuffer[MAX_IMAGE_BUFFERS]; // 255 is invalid, set by InvalidateImageInBuffer()
+  uint8_t NumberOfImageBuffers = 1;
+  uint8_t NumberOfFixedBuffers = 1; // the static one and the one for DMA, the rest are prefetch buffers
+  bool PrefetchBuffersEnabled = false;
+  uint8_t LastDrawnBuffer = 0;   // buffer pushed most recently
+
+  // Images of the digits that change at the next second, in drawing order, and when that second begins.
+  uint8_t PrefetchFiles[NUM_DIGITS];
+  uint8_t PrefetchCount = 0;
+  uint32_t PrefetchDeadline = 0; // millis()
+  uint32_t ImageLoadMs = 50;     // time to decode one image from the flash, measured
+#else
+  // Band mode: there is no image buffer. The image is decoded into the send stripes, TFT_BAND_ROWS rows at a time, and
+  // each band is sent as soon as the decoder has left it, while the next band is decoded into the other stripe.
+  static const uint8_t MAX_IMAGE_BUFFERS = 0;
+#ifdef USE_CLK_FILES
+  static const int8_t BAND_DIRECTION = 1; // CLK rows are stored top down
+#else
+  static const int8_t BAND_DIRECTION = -1; // BMP rows are stored bottom up
+#endif
+  uint8_t BandDigits = 0;    // digit map the bands go to
+  Overlay *BandOverlay = nullptr; // put into the bands before they are sent
+  int16_t BandFirstRow = -1; // display row the band being decoded starts at, -1 if none
+  bool DrawImageBands(uint8_t digit_map, uint8_t file_index);
+  void StartBand(int16_t first_row);
+  uint16_t *BandRow(int16_t row);
+  void SendBand();
+#endif
+  int8_t BufferInTransfer = -1;  // buffer currently sent by DMA, -1 if none, MAX_IMAGE_BUFFERS for a send stripe
+  bool DMAEnabled = false;
+
+#if !defined(DIM_WITH_ENABLE_PIN_PWM) || defined(DIGIT_TRANSITION) || defined(TFT_BAND_ROWS)
+  // Rows that are not sent straight from an image buffer (dimmed, or a transition frame) are put together in a stripe
+  // first. Two stripes for DMA: one is filled while the other one is on the wire.
+#ifdef TFT_BAND_ROWS
+  static const int16_t SEND_STRIPE_ROWS = TFT_BAND_ROWS;
+#else
+  static const int16_t SEND_STRIPE_ROWS = 16;
+#endif
+  alignas(4) static uint16_t SendStripe[2][SEND_STRIPE_ROWS][TFT_WIDTH];
+  uint8_t NextSendStripe = 0;
+  uint16_t (*GetSendStripe())[TFT_WIDTH];
+  void PushSendStripe(uint16_t (*stripe)[TFT_WIDTH], int16_t first_row, int16_t rows);
+#endif
+#ifndef DIM_WITH_ENABLE_PIN_PWM
+  // Software dimming: the image buffers and the glyph cache keep the undimmed pixels. Rows are dimmed while they are
+  // sent, so a brightness change needs no image to be loaded again.
+  void DimPixels(const uint16_t *source, uint16_t *target, uint32_t pixels);
+#endif
+  uint32_t ShownRowHash(uint32_t image_row_hash);
+
+  // Each image row is tracked by a hash: what is in the buffers (undimmed) and what each display currently shows.
+  // Only rows that differ from the display are sent. 0 means unknown, so the row is always sent.
+#ifndef TFT_BAND_ROWS
+  uint32_t ImageRowHash[MAX_IMAGE_BUFFERS][TFT_HEIGHT];
+  void HashImageRows(uint8_t buffer);
+#endif
+  uint32_t DisplayRowHash[NUM_DIGITS][TFT_HEIGHT];
+  uint32_t BlackRowHash = 0;
+  static uint32_t HashRow(const uint16_t *row);
+  bool IsRowShown(uint8_t digit_map, int16_t row, uint32_t hash);
+  void SetRowShown(uint8_t digit_map, int16_t row, uint32_t hash);
+  void InvalidateDisplayRows(uint8_t digit, int16_t first_row = 0, int16_t rows = TFT_HEIGHT);
+  void SetDisplayBlack(uint8_t digit);
+  bool IsDisplayBlack(uint8_t digit);
+
+#ifdef GLYPH_CACHE
+  // All ten digits of the active clock face, ready to be put into an image buffer without touching the flash.
+  // Stored with 8 bit per pixel and a palette of up to 256 colors, half the size of the decoded image. A digit with
+  // more colors keeps its RGB565 pixels in an extra block ("wide").
+  struct CachedGlyph
+  {
+    uint8_t pixels[TFT_HEIGHT][TFT_WIDTH];   // palette indexes
+    alignas(4) uint16_t palette[256];        // panel byte order
+#ifndef DIM_WITH_ENABLE_PIN_PWM
+    alignas(4) uint16_t dimmed_palette[256]; // with "palette_dimming" applied, for transition rows sent straight from the cache
+    uint8_t palette_dimming;                 // 255: dimmed_palette not made yet
+#endif
+    uint16_t colors;                         // palette entries used, 0 if the pixels are in "wide"
+    uint16_t (*wide)[TFT_WIDTH];             // in PSRAM, allocated when first needed and kept for reuse
+    uint32_t row_hash[TFT_HEIGHT];
+  };
+  CachedGlyph *GlyphCache = nullptr; // in PSRAM, nullptr if not available
+  uint16_t GlyphCacheValid = 0;      // one bit per digit value
+  uint16_t GlyphCacheFailed = 0;     // digits that could not be cached (no PSRAM for "wide"), not tried again for this face
+  uint8_t GlyphCacheFace = 0;
+  void AllocateGlyphCache();
+  void ReleaseGlyphCache();
+  CachedGlyph *GlyphCacheEntry(uint8_t file_index);
+  bool LoadFromGlyphCache(uint8_t file_index, uint8_t buffer);
+  void StoreInGlyphCache(uint8_t file_index, uint8_t buffer);
+  static bool IndexGlyph(CachedGlyph *glyph, const uint16_t (*image)[TFT_WIDTH]);
+  void ExpandGlyphRow(CachedGlyph *glyph, int16_t row, uint16_t *out, bool dimmed);
+  void FillGlyphCache();
+#endif
+
+#ifdef DIGIT_TRANSITION
+  // One running transition per display, from one digit value to the next. Both come from the glyph cache.
+  struct Transition
+  {
+    bool active;
+    uint8_t from, to;      // digit values, "blanked" is black
+    uint8_t frames, frame; // frames drawn so far, the last one shows "to"
+    uint32_t start;        // millis()
+  };
+  // Where one display row of a transition frame comes from: glyph row a blended with glyph row b by alpha (0..32).
+  // A glyph nullptr is black.
+  struct TransitionRow
+  {
+    CachedGlyph *a, *b;
+    int16_t row_a, row_b;
+    uint8_t alpha;
+    uint32_t hash;
+  };
+  Transition Transitions[NUM_DIGITS] = {};
+  uint8_t NextTransitionDigit = 0;                       // displays get their frames round robin
+  uint32_t PixelTimeNs = 16000000000ULL / SPI_FREQUENCY; // time to put together and send one pixel, measured
+  bool StartTransition(uint8_t digit, uint8_t from, uint8_t to);
+  CachedGlyph *TransitionGlyph(uint8_t value);
+  void GetTransitionRow(const Transition &t, CachedGlyph *from, CachedGlyph *to, uint16_t progress, int16_t row, TransitionRow &src);
+  void ComposeTransitionRow(const TransitionRow &src, uint16_t *out);
+  void RenderTransitionFrame(uint8_t digit, uint8_t frame);
+#endif
+  void CopyShownRow(const uint16_t *row, uint16_t *out); // with the current dimming
 
-  static uint16_t UnpackedImageBuffer[TFT_HEIGHT][TFT_WIDTH];
-  uint8_t FileInBuffer = 255; // invalid, always load first image
-  uint8_t NextFileRequired = 0;
+  static inline uint16_t toPanelOrder(uint16_t color) { return (color << 8) | (color >> 8); }
 
-  String patterns_str[9] = {"1", "2", "3", "4", "5", "6", "7", "8", "9"};
+  String patterns_str[MAX_CLOCK_FACES];
   void loadClockFacesNames();
 };
 
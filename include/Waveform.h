@@ -0,0 +1,63 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+/*
+ * Fixed point waveforms and the gamma curve for the backlights, without float and libm calls in the loop.
+ * A phase accumulator turns the elapsed microseconds into a 32 bit phase, a whole turn is 2^32. The waveforms are
+ * looked up in tables for that phase and interpolated linearly. The same elapsed time gives the same value, on the
+ * clock and on the host.
+ */
+
+#include <stdint.h>
+
+class PhaseAccumulator
+{
+public:
+  // Moves the phase on by the microseconds since the last call, at one turn per period_us (0 stops it).
+  // A changed period goes on from the current phase, so the animation doesn't jump.
+  uint32_t advance(uint32_t now_us, uint32_t period_us)
+  {
+    if (period_us != period)
+    {
+      period = period_us;
+      step = period != 0 ? (uint64_t(1) << 48) / period : 0;
+    }
+    if (started)
+      phase += uint64_t(now_us - last_us) * step;
+    last_us = now_us;
+    started = true;
+    return getPhase();
+  }
+  uint32_t getPhase() { return uint32_t(phase >> 16); }
+
+private:
+  uint64_t phase = 0; // 16 more bits below the phase, so slow periods don't drift
+  uint64_t step = 0;  // per microsecond, 2^48 / period
+  uint32_t period = 0;
+  uint32_t last_us = 0;
+  bool started = false;
+};
+
+class Waveform
+{
+public:
+  // |sin| of the phase, 0..255. Two pulses per turn.
+  static uint8_t absSine(uint32_t phase);
+  // (exp(sin) - 1/e) * 108 of the phase, 0..254: the breathing curve, one breath per turn.
+  static uint8_t breath(uint32_t phase);
+  // Colour value (sRGB like, gamma 2.2) to the linear light of the LED, 0..65535.
+  static uint16_t gamma16(uint8_t value) { return gamma_curve[value]; }
+
+private:
+  // Entry i and i + 1, with the 8 bit fraction between them.
+  static uint8_t interpolate(const uint8_t *table, uint16_t i, uint8_t fraction)
+  {
+    return table[i] + ((int16_t(table[i + 1]) - table[i]) * fraction >> 8);
+  }
+
+  static const uint8_t quarter_sine[257];
+  static const uint8_t breath_curve[257];
+  static const uint16_t gamma_curve[256];
+};
+
+#endif // WAVEFORM_H
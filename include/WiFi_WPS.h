@@ -12,7 +12,8 @@ enum WifiState_t
     wps_failed,
     num_states
 };
-void WifiBegin();
+// With wait = false, WiFi connects in the background (WifiState changes in the WiFi event handler) and nothing is drawn.
+void WifiBegin(bool wait = true);
 void WiFiStartWps();
 void WifiReconnect();
 
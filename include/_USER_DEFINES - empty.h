@@ -13,6 +13,8 @@
 // #define DEBUG_OUTPUT_MQTT   // Uncomment for Debug printing of MQTT messages
 // #define DEBUG_OUTPUT_RTC    // Uncomment for Debug printing of RTC chip initialization and time setting
 // #define DEBUG_OUTPUT_GEO    // Uncomment for Debug printing of Geolocation info
+#define LOOP_PROFILER          // Measure the stages of the main loop. Serial command "diag" shows them, with MQTT they are sent to <device>/diag
+// #define FAST_BOOT           // Uncomment to show the RTC time right after power-on, without boot messages. WiFi, NTP, MQTT and geolocation start in the background
 
 // ************* Clock font file type selection (.clk or .bmp)  *************
 // #define USE_CLK_FILES   // Select between .CLK and .BMP images
@@ -24,6 +26,16 @@
 #define BACKLIGHT_DIMMED_INTENSITY 1 // 0..7
 #define TFT_DIMMED_INTENSITY 20      // 0..255
 
+// ************* Backlights *************
+#define BACKLIGHT_MAX_FPS 50 // Frame rate cap of the animated backlight patterns (rainbow, pulse, breath). Lower leaves more CPU time to the rest
+#define BACKLIGHT_GAMMA_CORRECTION // Comment out to send the colours to the LEDs without gamma correction (mixed colours look brighter, like before)
+
+// ************* Display transfer *************
+// #define TFT_USE_DMA // Uncomment to send images to the displays with DMA. Needs an additional 64 kB of internal RAM for a second image buffer
+
+// ************* Digit transitions *************
+// #define DIGIT_TRANSITION 1 // Uncomment to animate digit changes: 1 = crossfade, 2 = vertical slide, 3 = flip. Only on boards with PSRAM (glyph cache)
+
 // ************* WiFi config *************
 #define WIFI_CONNECT_TIMEOUT_SEC 20                     // Seconds to wait for WiFi connection before timing out, if credentials are present
 #define WIFI_RETRY_CONNECTION_SEC 15                    // Seconds between WiFi reconnect attempts, if connection is lost or not established
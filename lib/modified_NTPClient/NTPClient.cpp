@@ -115,32 +115,77 @@ bool NTPClient::forceUpdate()
 {
   DBG("NTPClient::forceUpdate() - Update from NTP Server...");
 
+  if (!this->beginUpdate())
+    return false;
+
+  // Wait till data is there or timeout...
+  UpdateState state;
+  while ((state = this->pollUpdate()) == UPDATE_PENDING)
+    delay(10);
+  return state == UPDATE_DONE;
+}
+
+bool NTPClient::beginUpdate()
+{
+  DBG("NTPClient::beginUpdate() - Sending request to NTP Server...");
+
   // flush any existing packets
   while (this->_udp->parsePacket() != 0)
     this->_udp->flush();
 
+  this->_requestPending = false;
+  this->_requestSent = millis(); // t1
   if (!this->sendNTPPacket())
   {
-    DBG("NTPClient::forceUpdate() - Could not send packet");
+    DBG("NTPClient::beginUpdate() - Could not send packet");
     return false;
   }
+  this->_requestPending = true;
+  this->_lastPoll = this->_requestSent;
+  return true;
+}
 
-  // Wait till data is there or timeout...
-  byte timeout = 0;
-  int cb = 0;
-  do
+NTPClient::UpdateState NTPClient::pollUpdate()
+{
+  if (!this->_requestPending)
+    return UPDATE_FAILED;
+
+  unsigned long previousPoll = this->_lastPoll;
+  this->_lastPoll = millis();
+  if (this->_udp->parsePacket() == 0)
   {
-    delay(10);
-    cb = this->_udp->parsePacket();
-    if (timeout > 100)
-    {
-      DBG("NTPClient::forceUpdate() - Timeout!");
-      return false; // timeout after 1000 ms
-    }
-    timeout++;
-  } while (cb == 0);
+    if (this->_lastPoll - this->_requestSent <= NTP_TIMEOUT_MS)
+      return UPDATE_PENDING;
+    DBG("NTPClient::pollUpdate() - Timeout!");
+    this->_requestPending = false;
+    return UPDATE_FAILED;
+  }
+
+  this->_requestPending = false;
+  // t4: the answer arrived between the last two polls
+  return this->readNTPPacket(previousPoll + (this->_lastPoll - previousPoll) / 2) ? UPDATE_DONE : UPDATE_FAILED;
+}
 
-  this->_lastUpdate = millis() - (10 * (timeout + 1)); // Account for delay in reading the time
+bool NTPClient::isUpdatePending() const
+{
+  return this->_requestPending;
+}
+
+unsigned long NTPClient::getRoundTripMs() const
+{
+  return this->_roundTrip;
+}
+
+// NTP time stamp (seconds since 1900 and 32 bit fraction, big endian) in ms since 1900
+static unsigned long long ntpTimeStampToMillis(const byte *stamp)
+{
+  unsigned long seconds = (unsigned long)stamp[0] << 24 | (unsigned long)stamp[1] << 16 | stamp[2] << 8 | stamp[3];
+  unsigned long fraction = (unsigned long)stamp[4] << 24 | (unsigned long)stamp[5] << 16 | stamp[6] << 8 | stamp[7];
+  return seconds * 1000ULL + (((unsigned long long)fraction * 1000) >> 32);
+}
+
+bool NTPClient::readNTPPacket(unsigned long receivedAt)
+{
 
   byte _packetBuffer[NTP_PACKET_SIZE];
   // clear  buffer before receiving data from server
@@ -148,12 +193,12 @@ bool NTPClient::forceUpdate()
 
   if (this->_udp->read(_packetBuffer, NTP_PACKET_SIZE) != NTP_PACKET_SIZE)
   {
-    DBG("NTPClient::forceUpdate() - NTP err: Incorrect data size");
+    DBG("NTPClient::readNTPPacket() - NTP err: Incorrect data size");
     return false;
   }
 
 #ifdef DEBUG_NTPClient
-  Serial.print("NTPClient::forceUpdate() - Received NTP Data:");
+  Serial.print("NTPClient::readNTPPacket() - Received NTP Data:");
   char s1[4];
   for (int i = 0; i < NTP_PACKET_SIZE; i++)
   {
@@ -178,25 +223,25 @@ bool NTPClient::forceUpdate()
   // Perform a few validity checks on the packet
   if ((_packetBuffer[0] & 0b11000000) == 0b11000000) // Check for LI=UNSYNC
   {
-    DBG("NTPClient::forceUpdate() - err: NTP UnSync");
+    DBG("NTPClient::readNTPPacket() - err: NTP UnSync");
     return false;
   }
 
   if ((_packetBuffer[0] & 0b00111000) >> 3 < 0b100) // Check for Version >= 4
   {
-    DBG("NTPClient::forceUpdate() - err: Incorrect NTP Version");
+    DBG("NTPClient::readNTPPacket() - err: Incorrect NTP Version");
     return false;
   }
 
   if ((_packetBuffer[0] & 0b00000111) != 0b100) // Check for Mode == Server
   {
-    DBG("NTPClient::forceUpdate() - err: NTP mode is not Server");
+    DBG("NTPClient::readNTPPacket() - err: NTP mode is not Server");
     return false;
   }
 
   if ((_packetBuffer[1] < 1) || (_packetBuffer[1] > 15)) // Check for valid Stratum
   {
-    DBG("NTPClient::forceUpdate() - err: Incorrect NTP Stratum");
+    DBG("NTPClient::readNTPPacket() - err: Incorrect NTP Stratum");
     return false;
   }
 
@@ -205,19 +250,30 @@ bool NTPClient::forceUpdate()
       _packetBuffer[20] == 0 && _packetBuffer[21] == 0 &&
       _packetBuffer[22] == 0 && _packetBuffer[23] == 0) // Check for ReferenceTimestamp != 0
   {
-    DBG("NTPClient::forceUpdate() - err: Incorrect NTP Ref Timestamp");
+    DBG("NTPClient::readNTPPacket() - err: Incorrect NTP Ref Timestamp");
+    return false;
+  }
+
+  if (_packetBuffer[24] != (byte)(this->_requestSent >> 24) || _packetBuffer[25] != (byte)(this->_requestSent >> 16) ||
+      _packetBuffer[26] != (byte)(this->_requestSent >> 8) || _packetBuffer[27] != (byte)this->_requestSent) // Check for Originate == our Transmit
+  {
+    DBG("NTPClient::readNTPPacket() - err: Answer to another request");
     return false;
   }
 
-  unsigned long highWord = word(_packetBuffer[40], _packetBuffer[41]);
-  unsigned long lowWord = word(_packetBuffer[42], _packetBuffer[43]);
-  // combine the four bytes (two words) into a long integer
-  // this is NTP time (seconds since Jan 1 1900):
-  unsigned long secsSince1900 = highWord << 16 | lowWord;
+  // t2 and t3: the server received the request and sent the answer. The network delay is the round trip without the
+  // time in between, the answer took half of it.
+  unsigned long long serverReceived = ntpTimeStampToMillis(_packetBuffer + 32);
+  unsigned long long serverSent = ntpTimeStampToMillis(_packetBuffer + 40);
+  long roundTrip = (long)(receivedAt - this->_requestSent) - (long)(serverSent - serverReceived);
+  this->_roundTrip = roundTrip > 0 ? roundTrip : 0;
+  unsigned long long epochMillis = serverSent - SEVENZYYEARS * 1000ULL + this->_roundTrip / 2;
 
-  this->_currentEpoc = secsSince1900 - SEVENZYYEARS;
+  this->_currentEpoc = epochMillis / 1000;
+  this->_currentMillis = epochMillis % 1000;
+  this->_lastUpdate = receivedAt;
 
-  DBG("NTPClient::forceUpdate() - NTP time successfully received!");
+  DBG("NTPClient::readNTPPacket() - NTP time successfully received!");
 
   return true;
 }
@@ -242,9 +298,14 @@ bool NTPClient::isTimeSet() const
 
 unsigned long NTPClient::getEpochTime() const
 {
-  return this->_timeOffset +                      // User offset
-         this->_currentEpoc +                     // Epoch returned by the NTP server
-         ((millis() - this->_lastUpdate) / 1000); // Time since last update
+  return this->_timeOffset +                                              // User offset
+         this->_currentEpoc +                                             // Epoch returned by the NTP server
+         ((this->_currentMillis + (millis() - this->_lastUpdate)) / 1000); // Time since last update
+}
+
+unsigned long long NTPClient::getEpochMillis(unsigned long atMillis) const
+{
+  return (this->_timeOffset + (unsigned long long)this->_currentEpoc) * 1000 + this->_currentMillis + (long)(atMillis - this->_lastUpdate);
 }
 
 int NTPClient::getDay() const
@@ -317,6 +378,11 @@ bool NTPClient::sendNTPPacket()
   _packetBuffer[13] = 0x4E;
   _packetBuffer[14] = 49;
   _packetBuffer[15] = 52;
+  // Transmit time stamp: the server returns it as originate time stamp, so the answer can be matched to this request
+  _packetBuffer[40] = this->_requestSent >> 24;
+  _packetBuffer[41] = this->_requestSent >> 16;
+  _packetBuffer[42] = this->_requestSent >> 8;
+  _packetBuffer[43] = this->_requestSent;
 
   // all NTP fields have been given values, now
   // you can send a packet requesting a timestamp:
@@ -9,6 +9,7 @@
 #define SEVENZYYEARS 2208988800UL
 #define NTP_PACKET_SIZE 48
 #define NTP_DEFAULT_LOCAL_PORT 1337
+#define NTP_TIMEOUT_MS 1000 // an answer arriving later is ignored
 
 // #define DEBUG_NTPClient
 
@@ -25,12 +26,26 @@ private:
 
   unsigned long _updateInterval = 60000; // In ms
 
-  unsigned long _currentEpoc = 0; // In s
-  unsigned long _lastUpdate = 0;  // In ms
+  unsigned long _currentEpoc = 0;   // In s
+  unsigned int _currentMillis = 0;  // Fraction of _currentEpoc, in ms
+  unsigned long _lastUpdate = 0;    // In ms, millis() when the time was _currentEpoc + _currentMillis
+  unsigned long _roundTrip = 0;     // In ms, network delay of the last answer (without the time the server needed)
+
+  bool _requestPending = false;
+  unsigned long _requestSent = 0; // In ms, also sent as transmit time stamp and checked in the answer
+  unsigned long _lastPoll = 0;    // In ms
 
   bool sendNTPPacket();
+  bool readNTPPacket(unsigned long receivedAt);
 
 public:
+  enum UpdateState
+  {
+    UPDATE_PENDING, // waiting for the answer
+    UPDATE_DONE,    // time set from the answer
+    UPDATE_FAILED   // no request pending, bad answer or timeout
+  };
+
   NTPClient(UDP &udp);
   NTPClient(UDP &udp, long timeOffset);
   NTPClient(UDP &udp, const char *poolServerName);
@@ -77,6 +92,32 @@ public:
    */
   bool forceUpdate();
 
+  /**
+   * Sends a request to the NTP Server and returns at once, without waiting for the answer.
+   * Call pollUpdate() on later loops to pick it up.
+   *
+   * @return true if the request was sent
+   */
+  bool beginUpdate();
+
+  /**
+   * Checks for the answer to the request of beginUpdate(), without waiting.
+   *
+   * @return UPDATE_PENDING until the answer is there, then UPDATE_DONE, or UPDATE_FAILED for a bad answer or after NTP_TIMEOUT_MS
+   */
+  UpdateState pollUpdate();
+
+  /**
+   * @return true if a request was sent and its answer was not picked up yet
+   */
+  bool isUpdatePending() const;
+
+  /**
+   * @return round trip of the last answer in ms, without the time the server needed. Half of it is added to the
+   * server's transmit time stamp.
+   */
+  unsigned long getRoundTripMs() const;
+
   /**
    * This allows to check if the NTPClient successfully received a NTP packet and set the time.
    *
@@ -110,6 +151,11 @@ public:
    */
   unsigned long getEpochTime() const;
 
+  /**
+   * @return time in ms since Jan. 1, 1970, at the given millis(). Sub-second, from the fraction of the time stamps.
+   */
+  unsigned long long getEpochMillis(unsigned long atMillis) const;
+
   /**
    * Stops the underlying UDP client
    */
@@ -0,0 +1,55 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the Adafruit NeoPixel library.
+ *   Pixel storage and brightness scaling follow the library (brightness is applied when a pixel is set, and
+ *   setBrightness() rescales the stored pixels), so patterns produce the same values as on the clock.
+ *   show() does not block; it counts the frames and the time the WS2812 data would take on the wire.
+ */
+
+#ifndef NATIVE_ADAFRUIT_NEOPIXEL_H_
+#define NATIVE_ADAFRUIT_NEOPIXEL_H_
+
+#include <Arduino.h>
+
+typedef uint16_t neoPixelType;
+
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+#define NEO_KHZ400 0x0100
+
+class Adafruit_NeoPixel
+{
+public:
+  Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800);
+  ~Adafruit_NeoPixel();
+
+  void begin() {}
+  void show();
+  bool canShow() { return true; }
+  void setPin(int16_t p) { pin = p; }
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+  void setPixelColor(uint16_t n, uint32_t c) { setPixelColor(n, uint8_t(c >> 16), uint8_t(c >> 8), uint8_t(c)); }
+  void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0);
+  void setBrightness(uint8_t b);
+  void clear();
+  uint8_t *getPixels() const { return pixels; }
+  uint8_t getBrightness() const { return brightness - 1; }
+  int16_t getPin() const { return pin; }
+  uint16_t numPixels() const { return numLEDs; }
+  uint32_t getPixelColor(uint16_t n) const;
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) { return (uint32_t(r) << 16) | (uint32_t(g) << 8) | b; }
+
+  // Statistics of the host shim
+  static uint32_t shows;        // calls to show()
+  static uint64_t wire_time_us; // time the LED data would have been on the wire
+
+protected:
+  uint16_t numLEDs;
+  uint8_t brightness = 0; // stored as brightness + 1, 0 = full brightness, like the library
+  uint8_t *pixels;        // 3 bytes per pixel, R G B, already scaled by the brightness
+  int16_t pin;
+};
+
+#endif // NATIVE_ADAFRUIT_NEOPIXEL_H_
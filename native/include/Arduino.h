@@ -0,0 +1,239 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Minimal Arduino core shim for the host ("native") build.
+ *   Only what the rendering, backlight and clock code actually uses is provided.
+ *   Time is taken from the host's monotonic clock, so millis()/micros() are real. native_skip_ms() moves it forward.
+ */
+
+#ifndef NATIVE_ARDUINO_H_
+#define NATIVE_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <driver/gpio.h>
+
+#define NATIVE_BUILD_SHIMS
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define F(string_literal) (string_literal)
+#define PROGMEM
+#define IRAM_ATTR
+
+using std::max;
+using std::min;
+
+uint32_t millis();
+uint32_t micros();
+// Moves millis(), micros() and the host time seen by the RTC and NTP shims forward, to simulate hours in a benchmark.
+void native_skip_ms(uint32_t ms);
+uint64_t native_time_ms(); // host UTC time in ms, plus the skipped time
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+inline bool psramFound() { return true; }
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+extern uint8_t native_pin_level[64]; // input levels seen by digitalRead(), all HIGH (buttons released) at start
+inline int digitalRead(uint8_t pin) { return pin < 64 ? native_pin_level[pin] : HIGH; }
+inline uint16_t analogRead(uint8_t) { return 0; }
+extern uint8_t native_shift_register; // last byte shifted out, the TFT shim derives the selected displays from it
+inline void shiftOut(uint8_t, uint8_t, uint8_t, uint8_t val) { native_shift_register = val; }
+inline uint32_t ledcSetup(uint8_t, uint32_t freq, uint8_t) { return freq; }
+inline void ledcWrite(uint8_t, uint32_t) {}
+inline void ledcAttachPin(uint8_t, uint8_t) {}
+inline uint32_t ledcChangeFrequency(uint8_t, uint32_t freq, uint8_t) { return freq; }
+
+void randomSeed(unsigned long seed);
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+inline uint16_t word(uint8_t h, uint8_t l) { return (uint16_t(h) << 8) | l; }
+
+class String
+{
+public:
+  String() {}
+  String(const char *s) : s_(s ? s : "") {}
+  String(const std::string &s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(int v) : s_(std::to_string(v)) {}
+  String(unsigned int v) : s_(std::to_string(v)) {}
+  String(long v) : s_(std::to_string(v)) {}
+  String(unsigned long v) : s_(std::to_string(v)) {}
+  String(float v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+  String(double v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned int length() const { return s_.length(); }
+  void replace(const String &find, const String &repl)
+  {
+    if (find.s_.empty())
+      return;
+    size_t pos = 0;
+    while ((pos = s_.find(find.s_, pos)) != std::string::npos)
+    {
+      s_.replace(pos, find.s_.length(), repl.s_);
+      pos += repl.s_.length();
+    }
+  }
+  void toCharArray(char *buf, unsigned int bufsize) const
+  {
+    if (!buf || !bufsize)
+      return;
+    size_t n = std::min<size_t>(bufsize - 1, s_.length());
+    memcpy(buf, s_.data(), n);
+    buf[n] = '\0';
+  }
+  int toInt() const { return atoi(s_.c_str()); }
+  bool startsWith(const String &p) const { return s_.compare(0, p.s_.length(), p.s_) == 0; }
+  void trim()
+  {
+    size_t b = s_.find_first_not_of(" \t\r\n");
+    size_t e = s_.find_last_not_of(" \t\r\n");
+    s_ = (b == std::string::npos) ? std::string() : s_.substr(b, e - b + 1);
+  }
+
+  String &operator+=(const String &o)
+  {
+    s_ += o.s_;
+    return *this;
+  }
+  String &operator+=(char c)
+  {
+    s_ += c;
+    return *this;
+  }
+  friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+  friend String operator+(const String &a, const char *b) { return String(a.s_ + b); }
+  friend String operator+(const char *a, const String &b) { return String(a + b.s_); }
+  bool operator==(const String &o) const { return s_ == o.s_; }
+  bool operator==(const char *o) const { return s_ == o; }
+  bool operator!=(const String &o) const { return s_ != o.s_; }
+  char operator[](unsigned int i) const { return s_[i]; }
+
+private:
+  void fromDouble(double v, unsigned int decimals)
+  {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    s_ = buf;
+  }
+  std::string s_;
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--)
+      n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char *str) { return str ? write(reinterpret_cast<const uint8_t *>(str), strlen(str)) : 0; }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write(uint8_t(c)); }
+  size_t print(int v, int base = 10) { return printNumber(long(v), base); }
+  size_t print(unsigned int v, int base = 10) { return printNumber((unsigned long)v, base); }
+  size_t print(long v, int base = 10) { return printNumber(v, base); }
+  size_t print(unsigned long v, int base = 10) { return printNumber(v, base); }
+  size_t print(long long v, int base = 10) { return printNumber(long(v), base); }
+  size_t print(unsigned long long v, int base = 10) { return printNumber((unsigned long)v, base); }
+  size_t print(double v, int digits = 2)
+  {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, v);
+    return write(buf);
+  }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T &v) { return print(v) + println(); }
+  template <typename T>
+  size_t println(const T &v, int arg) { return print(v, arg) + println(); }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+  {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return write(buf);
+  }
+
+private:
+  size_t printNumber(long v, int base)
+  {
+    char buf[40];
+    snprintf(buf, sizeof(buf), base == 16 ? "%lX" : "%ld", v);
+    return write(buf);
+  }
+  size_t printNumber(unsigned long v, int base)
+  {
+    char buf[40];
+    snprintf(buf, sizeof(buf), base == 16 ? "%lX" : "%lu", v);
+    return write(buf);
+  }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() { return -1; }
+  virtual void flush() {}
+  String readStringUntil(char terminator)
+  {
+    std::string s;
+    int c;
+    while ((c = read()) >= 0 && c != terminator)
+      s += char(c);
+    return String(s);
+  }
+};
+
+// Serial output goes to stdout, unless silenced by the benchmark harness.
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override
+  {
+    if (enabled)
+      fputc(c, stdout);
+    return 1;
+  }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  bool enabled = true;
+};
+
+extern HardwareSerial Serial;
+
+#endif // NATIVE_ARDUINO_H_
@@ -0,0 +1,101 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the Arduino-ESP32 file system API, backed by stdio.
+ */
+
+#ifndef NATIVE_FS_H_
+#define NATIVE_FS_H_
+
+#include <Arduino.h>
+#include <memory>
+
+namespace fs
+{
+
+  enum SeekMode
+  {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+  };
+
+  class File : public Stream
+  {
+  public:
+    File() {}
+    File(FILE *f, bool is_dir = false) : f_(f ? std::shared_ptr<FILE>(f, fclose) : nullptr), is_dir_(is_dir) {}
+
+    size_t write(uint8_t c) override { return f_ ? fwrite(&c, 1, 1, f_.get()) : 0; }
+    size_t write(const uint8_t *buf, size_t size) override { return f_ ? fwrite(buf, 1, size, f_.get()) : 0; }
+    int available() override
+    {
+      if (!f_)
+        return 0;
+      long pos = ftell(f_.get());
+      return int(size() - pos);
+    }
+    int read() override
+    {
+      if (!f_)
+        return -1;
+      reads++;
+      int c = fgetc(f_.get());
+      return c == EOF ? -1 : c;
+    }
+    size_t read(uint8_t *buf, size_t size)
+    {
+      if (!f_)
+        return 0;
+      reads++;
+      return fread(buf, 1, size, f_.get());
+    }
+    bool seek(uint32_t pos, SeekMode mode = SeekSet)
+    {
+      if (!f_)
+        return false;
+      seeks++;
+      return fseek(f_.get(), pos, mode == SeekSet ? SEEK_SET : (mode == SeekCur ? SEEK_CUR : SEEK_END)) == 0;
+    }
+    size_t position() const { return f_ ? ftell(f_.get()) : 0; }
+    size_t size() const
+    {
+      if (!f_)
+        return 0;
+      long pos = ftell(f_.get());
+      fseek(f_.get(), 0, SEEK_END);
+      long end = ftell(f_.get());
+      fseek(f_.get(), pos, SEEK_SET);
+      return end;
+    }
+    void close() { f_.reset(); }
+    bool isDirectory() const { return is_dir_; }
+    operator bool() const { return f_ != nullptr || is_dir_; }
+
+    // Number of read()/seek() calls on all files, used by the benchmark to count file system round trips.
+    static uint32_t reads;
+    static uint32_t seeks;
+
+  private:
+    std::shared_ptr<FILE> f_;
+    bool is_dir_ = false;
+  };
+
+  class FS
+  {
+  public:
+    File open(const char *path, const char *mode = "r", bool create = false);
+    File open(const String &path, const char *mode = "r", bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+
+    // Host directory that stands in for the root of the file system.
+    void setRoot(const char *root) { root_ = root; }
+    static uint32_t opens;
+
+  protected:
+    std::string root_ = "data";
+  };
+
+} // namespace fs
+
+#endif // NATIVE_FS_H_
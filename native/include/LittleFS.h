@@ -0,0 +1,22 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of LittleFS, serving files from a directory on the host (default: "data").
+ */
+
+#ifndef NATIVE_LITTLEFS_H_
+#define NATIVE_LITTLEFS_H_
+
+#include <FS.h>
+
+class LittleFSFS : public fs::FS
+{
+public:
+  bool begin(bool formatOnFail = false, const char *basePath = "/littlefs", uint8_t maxOpenFiles = 10, const char *partitionLabel = "spiffs") { return true; }
+  void end() {}
+  size_t totalBytes() { return 0x3C0000; }
+  size_t usedBytes() { return 0; }
+};
+
+extern LittleFSFS LittleFS;
+
+#endif // NATIVE_LITTLEFS_H_
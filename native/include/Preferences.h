@@ -0,0 +1,56 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the ESP32 Preferences (NVS) library. Values live in memory only.
+ */
+
+#ifndef NATIVE_PREFERENCES_H_
+#define NATIVE_PREFERENCES_H_
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+class Preferences
+{
+public:
+  bool begin(const char *name, bool readOnly = false, const char *partition_label = NULL)
+  {
+    ns_ = name;
+    return true;
+  }
+  void end() {}
+  bool clear()
+  {
+    store().clear();
+    return true;
+  }
+  size_t putBytes(const char *key, const void *value, size_t len)
+  {
+    const uint8_t *v = static_cast<const uint8_t *>(value);
+    store()[ns_ + "/" + key].assign(v, v + len);
+    return len;
+  }
+  size_t getBytesLength(const char *key)
+  {
+    auto it = store().find(ns_ + "/" + key);
+    return it == store().end() ? 0 : it->second.size();
+  }
+  size_t getBytes(const char *key, void *buf, size_t maxLen)
+  {
+    auto it = store().find(ns_ + "/" + key);
+    if (it == store().end() || it->second.size() > maxLen)
+      return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+
+private:
+  static std::map<std::string, std::vector<uint8_t>> &store()
+  {
+    static std::map<std::string, std::vector<uint8_t>> values;
+    return values;
+  }
+  std::string ns_;
+};
+
+#endif // NATIVE_PREFERENCES_H_
@@ -0,0 +1,71 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the Adafruit RTClib, DS3231 only.
+ *   The RTC runs from the host clock (native_time_ms()), native_rtc_drift_ppm faster. adjust() restarts the second
+ *   like the DS3231 does when its seconds register is written, so a set time keeps running from there.
+ */
+
+#ifndef NATIVE_RTCLIB_H_
+#define NATIVE_RTCLIB_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <time.h>
+
+class DateTime
+{
+public:
+  DateTime(uint32_t t = 0) : t_(t) {}
+  DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0)
+  {
+    struct tm tm = {};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = min;
+    tm.tm_sec = sec;
+    t_ = uint32_t(timegm(&tm));
+  }
+  uint32_t unixtime() const { return t_; }
+
+private:
+  uint32_t t_;
+};
+
+enum Ds3231SqwPinMode
+{
+  DS3231_OFF = 0x1C,
+  DS3231_SquareWave1Hz = 0x00
+};
+
+extern double native_rtc_drift_ppm; // > 0: the simulated RTC runs fast
+
+class RTC_DS3231
+{
+public:
+  bool begin(TwoWire *wireInstance = &Wire) { return true; }
+  bool lostPower() { return false; }
+  void adjust(const DateTime &dt)
+  {
+    set_at_ms_ = native_time_ms();
+    set_to_ms_ = uint64_t(dt.unixtime()) * 1000;
+  }
+  DateTime now()
+  {
+    uint64_t now_ms = native_time_ms();
+    if (set_at_ms_ == 0)
+      set_at_ms_ = set_to_ms_ = now_ms - now_ms % 1000; // not set yet: counts the host seconds
+    double elapsed_ms = double(now_ms - set_at_ms_);
+    return DateTime(uint32_t((set_to_ms_ + uint64_t(elapsed_ms * (1 + native_rtc_drift_ppm / 1e6))) / 1000));
+  }
+  Ds3231SqwPinMode readSqwPinMode() { return DS3231_OFF; }
+  bool isEnabled32K() { return false; }
+  float getTemperature() { return 25.0f; }
+
+private:
+  uint64_t set_at_ms_ = 0; // native_time_ms() when adjust() was called
+  uint64_t set_to_ms_ = 0;
+};
+
+#endif // NATIVE_RTCLIB_H_
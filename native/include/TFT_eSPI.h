@@ -0,0 +1,184 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the TFT_eSPI library.
+ *   Keeps one frame buffer per display. Pixels are written to every display selected in the 74HC595 chip select
+ *   shift register (see ChipSelect::update()), so the benchmark can count the SPI traffic and verify what the
+ *   panels would show. DMA transfers complete immediately.
+ */
+
+#ifndef NATIVE_TFT_ESPI_H_
+#define NATIVE_TFT_ESPI_H_
+
+#include <Arduino.h>
+#include "GLOBAL_DEFINES.h"
+
+#define TFT_BLACK 0x0000
+#define TFT_NAVY 0x000F
+#define TFT_DARKGREEN 0x03E0
+#define TFT_MAROON 0x7800
+#define TFT_PURPLE 0x780F
+#define TFT_OLIVE 0x7BE0
+#define TFT_LIGHTGREY 0xD69A
+#define TFT_DARKGREY 0x7BEF
+#define TFT_BLUE 0x001F
+#define TFT_GREEN 0x07E0
+#define TFT_CYAN 0x07FF
+#define TFT_RED 0xF800
+#define TFT_MAGENTA 0xF81F
+#define TFT_YELLOW 0xFFE0
+#define TFT_WHITE 0xFFFF
+#define TFT_ORANGE 0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_PINK 0xFE19
+#define TFT_TRANSPARENT 0x0120
+
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define MC_DATUM 4
+#define MR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+
+class TFT_eSPI : public Print
+{
+public:
+  TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT) : _width(w), _height(h) {}
+  virtual ~TFT_eSPI() {}
+
+  void init(uint8_t tc = 0) {}
+  void begin(uint8_t tc = 0) { init(tc); }
+  int16_t width() { return _width; }
+  int16_t height() { return _height; }
+
+  virtual void drawPixel(int32_t x, int32_t y, uint32_t color) { fillRect(x, y, 1, 1, color); }
+  virtual void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+  void fillScreen(uint32_t color) { fillRect(0, 0, _width, _height, color); }
+  void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) { fillRect(x, y, w, 1, color); }
+  void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) { fillRect(x, y, 1, h, color); }
+  void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+  {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+  }
+  void drawXBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color, uint16_t bgcolor)
+  {
+    for (int16_t j = 0; j < h; j++)
+    {
+      for (int16_t i = 0; i < w; i++)
+        drawPixel(x + i, y + j, (bitmap[j * ((w + 7) / 8) + i / 8] >> (i & 7)) & 1 ? color : bgcolor);
+    }
+  }
+
+  // Text is not rasterised; every glyph is drawn as a filled cell, which is enough to account for the SPI traffic.
+  void setTextColor(uint16_t fg) { textcolor = textbgcolor = fg; }
+  void setTextColor(uint16_t fg, uint16_t bg, bool bgfill = false)
+  {
+    textcolor = fg;
+    textbgcolor = bg;
+  }
+  void setCursor(int16_t x, int16_t y)
+  {
+    cursor_x = x;
+    cursor_y = y;
+  }
+  void setCursor(int16_t x, int16_t y, uint8_t font)
+  {
+    setTextFont(font);
+    setCursor(x, y);
+  }
+  int16_t getCursorX() { return cursor_x; }
+  int16_t getCursorY() { return cursor_y; }
+  void setTextFont(uint8_t font) { textfont = font; }
+  void setTextSize(uint8_t size) { textsize = size ? size : 1; }
+  void setTextDatum(uint8_t datum) { textdatum = datum; }
+  void setTextPadding(uint16_t) {}
+  int16_t fontHeight(int16_t font) { return (font == 4 ? 26 : (font == 2 ? 16 : 8)) * textsize; }
+  int16_t fontHeight() { return fontHeight(textfont); }
+  int16_t textWidth(const char *string, uint8_t font) { return strlen(string) * charWidth(font); }
+  int16_t textWidth(const char *string) { return textWidth(string, textfont); }
+  int16_t textWidth(const String &string) { return textWidth(string.c_str(), textfont); }
+  int16_t drawString(const char *string, int32_t x, int32_t y, uint8_t font);
+  int16_t drawString(const char *string, int32_t x, int32_t y) { return drawString(string, x, y, textfont); }
+  int16_t drawString(const String &string, int32_t x, int32_t y) { return drawString(string.c_str(), x, y, textfont); }
+  int16_t drawString(const String &string, int32_t x, int32_t y, uint8_t font) { return drawString(string.c_str(), x, y, font); }
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  void setSwapBytes(bool swap) { _swapBytes = swap; }
+  bool getSwapBytes() { return _swapBytes; }
+
+  void startWrite() { inTransaction = true; }
+  void endWrite() { inTransaction = false; }
+  void setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h);
+  void pushPixels(const void *data_in, uint32_t len);
+  void pushBlock(uint16_t color, uint32_t len);
+  void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data);
+  void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data) { pushImage(x, y, w, h, const_cast<uint16_t *>(data)); }
+
+  bool initDMA(bool ctrl_cs = false)
+  {
+    DMA_Enabled = true;
+    return true;
+  }
+  void deInitDMA() { DMA_Enabled = false; }
+  bool dmaBusy() { return false; }
+  void dmaWait() {}
+  void pushPixelsDMA(uint16_t *image, uint32_t len);
+  void pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data, uint16_t *buffer = nullptr);
+
+  uint16_t color565(uint8_t r, uint8_t g, uint8_t b) { return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3); }
+  uint16_t alphaBlend(uint8_t alpha, uint16_t fgc, uint16_t bgc);
+
+  bool DMA_Enabled = false;
+
+  // Statistics and panel contents of the host shim
+  static uint64_t pixels_sent;  // pixels clocked out on the bus
+  static uint32_t transactions; // address windows opened
+  static uint16_t panel[NUM_DIGITS][TFT_HEIGHT][TFT_WIDTH];
+  static uint8_t selectedDisplays();
+
+protected:
+  int32_t _width, _height;
+  int16_t cursor_x = 0, cursor_y = 0;
+  uint16_t textcolor = TFT_WHITE, textbgcolor = TFT_BLACK;
+  uint8_t textfont = 1, textsize = 1, textdatum = TL_DATUM;
+  bool _swapBytes = false;
+  bool inTransaction = false;
+
+  int16_t charWidth(uint8_t font) { return (font == 4 ? 14 : (font == 2 ? 8 : 6)) * textsize; }
+
+private:
+  void writeColor(uint16_t color);
+  int32_t win_x0 = 0, win_y0 = 0, win_x1 = 0, win_y1 = 0, win_x = 0, win_y = 0;
+};
+
+class TFT_eSprite : public TFT_eSPI
+{
+public:
+  explicit TFT_eSprite(TFT_eSPI *tft) : TFT_eSPI(0, 0), _tft(tft) {}
+  ~TFT_eSprite() { deleteSprite(); }
+
+  void *createSprite(int16_t w, int16_t h, uint8_t frames = 1);
+  void deleteSprite();
+  bool created() { return _buffer != nullptr; }
+  void *setColorDepth(int8_t b);
+  int8_t getColorDepth() { return _bpp; }
+  void *getPointer() { return _buffer; }
+
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override;
+  void fillSprite(uint32_t color) { fillRect(0, 0, _width, _height, color); }
+  uint16_t readPixel(int32_t x, int32_t y);
+  void pushSprite(int32_t x, int32_t y);
+
+private:
+  TFT_eSPI *_tft;
+  uint8_t *_buffer = nullptr;
+  int8_t _bpp = 16;
+};
+
+#endif // NATIVE_TFT_ESPI_H_
@@ -0,0 +1,44 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the Arduino UDP interface and IPAddress.
+ */
+
+#ifndef NATIVE_UDP_H_
+#define NATIVE_UDP_H_
+
+#include <Arduino.h>
+
+class IPAddress
+{
+public:
+  IPAddress() : IPAddress(0, 0, 0, 0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+  uint8_t operator[](int index) const { return bytes[index]; }
+  bool operator==(const IPAddress &o) const { return memcmp(bytes, o.bytes, 4) == 0; }
+  String toString() const
+  {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+    return String(buf);
+  }
+
+private:
+  uint8_t bytes[4];
+};
+
+class UDP : public Stream
+{
+public:
+  virtual uint8_t begin(uint16_t port) = 0;
+  virtual void stop() = 0;
+  virtual int beginPacket(IPAddress ip, uint16_t port) = 0;
+  virtual int beginPacket(const char *host, uint16_t port) = 0;
+  virtual int endPacket() = 0;
+  virtual int parsePacket() = 0;
+  virtual int read(unsigned char *buffer, size_t len) = 0;
+  virtual int read(char *buffer, size_t len) { return read(reinterpret_cast<unsigned char *>(buffer), len); }
+  using Stream::read;
+  using Stream::write;
+};
+
+#endif // NATIVE_UDP_H_
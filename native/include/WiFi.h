@@ -0,0 +1,30 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the ESP32 WiFi library. Only the parts the clock core needs.
+ */
+
+#ifndef NATIVE_WIFI_H_
+#define NATIVE_WIFI_H_
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+typedef enum
+{
+  WL_IDLE_STATUS = 0,
+  WL_CONNECTED = 3,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+class WiFiClass
+{
+public:
+  wl_status_t status() { return native_ntp_online ? WL_CONNECTED : WL_DISCONNECTED; }
+  bool isConnected() { return status() == WL_CONNECTED; }
+  String macAddress() { return String("00:00:00:00:00:00"); }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+};
+
+extern WiFiClass WiFi;
+
+#endif // NATIVE_WIFI_H_
@@ -0,0 +1,63 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the ESP32 WiFiUDP class.
+ *   Instead of a network it talks to a built-in NTP server: every request sent to port 123 is answered
+ *   after native_ntp_delay_ms (simulated round trip), with the host's time halfway through it. So the NTP client and the clock
+ *   code run their real paths, including the time they wait for the answer.
+ */
+
+#ifndef NATIVE_WIFIUDP_H_
+#define NATIVE_WIFIUDP_H_
+
+#include <Udp.h>
+
+extern uint32_t native_ntp_delay_ms; // round trip of the simulated NTP server
+extern bool native_ntp_online;       // false: requests are never answered
+
+class WiFiUDP : public UDP
+{
+public:
+  uint8_t begin(uint16_t port) override { return 1; }
+  void stop() override { pending = false; }
+  int beginPacket(IPAddress ip, uint16_t port) override { return beginPacket("", port); }
+  int beginPacket(const char *host, uint16_t port) override
+  {
+    tx_len = 0;
+    tx_port = port;
+    return 1;
+  }
+  size_t write(uint8_t c) override
+  {
+    if (tx_len < sizeof(tx))
+      tx[tx_len++] = c;
+    return 1;
+  }
+  using UDP::write;
+  int endPacket() override;
+  int parsePacket() override;
+  int available() override { return rx_len - rx_pos; }
+  int read() override { return rx_pos < rx_len ? rx[rx_pos++] : -1; }
+  int read(unsigned char *buffer, size_t len) override
+  {
+    size_t n = min<size_t>(len, rx_len - rx_pos);
+    memcpy(buffer, rx + rx_pos, n);
+    rx_pos += n;
+    return n;
+  }
+  using UDP::read;
+  void flush() override { rx_pos = rx_len; }
+
+  static uint32_t requests; // NTP requests seen by the simulated server
+
+private:
+  uint8_t tx[48];
+  size_t tx_len = 0;
+  uint16_t tx_port = 0;
+  uint8_t rx[48];
+  size_t rx_len = 0, rx_pos = 0;
+  bool pending = false;
+  uint32_t answer_at = 0;
+  uint64_t server_ms = 0; // receive and transmit time stamp of the answer, native_time_ms()
+};
+
+#endif // NATIVE_WIFIUDP_H_
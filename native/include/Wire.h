@@ -0,0 +1,27 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the Arduino I2C (Wire) library. There is no bus; reads return nothing.
+ */
+
+#ifndef NATIVE_WIRE_H_
+#define NATIVE_WIRE_H_
+
+#include <Arduino.h>
+
+class TwoWire : public Stream
+{
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { return true; }
+  void beginTransmission(uint16_t address) {}
+  uint8_t endTransmission(bool sendStop = true) { return 0; }
+  uint8_t requestFrom(uint16_t address, uint8_t size) { return 0; }
+  size_t write(uint8_t) override { return 1; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif // NATIVE_WIRE_H_
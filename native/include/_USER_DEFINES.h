@@ -0,0 +1,7 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: User settings of the host ("native") build.
+ *   The defaults from the template, so the benchmark results do not depend on the local configuration.
+ */
+
+#include "_USER_DEFINES - empty.h"
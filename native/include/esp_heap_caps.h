@@ -0,0 +1,22 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the ESP-IDF capability based heap allocator.
+ */
+
+#ifndef NATIVE_ESP_HEAP_CAPS_H_
+#define NATIVE_ESP_HEAP_CAPS_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+inline void *heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+inline void heap_caps_free(void *ptr) { free(ptr); }
+inline size_t heap_caps_get_free_size(uint32_t) { return 4 * 1024 * 1024; }
+inline size_t heap_caps_get_largest_free_block(uint32_t) { return 4 * 1024 * 1024; }
+
+#endif // NATIVE_ESP_HEAP_CAPS_H_
@@ -0,0 +1,84 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the Adafruit NeoPixel library, see Adafruit_NeoPixel.h.
+ */
+
+#include <Adafruit_NeoPixel.h>
+
+uint32_t Adafruit_NeoPixel::shows = 0;
+uint64_t Adafruit_NeoPixel::wire_time_us = 0;
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, int16_t p, neoPixelType type) : numLEDs(n), pin(p)
+{
+  pixels = static_cast<uint8_t *>(calloc(n, 3));
+}
+
+Adafruit_NeoPixel::~Adafruit_NeoPixel()
+{
+  free(pixels);
+}
+
+void Adafruit_NeoPixel::show()
+{
+  shows++;
+  wire_time_us += (numLEDs * 24 * 125) / 100 + 300; // 1.25 us per bit at 800 kHz, plus the latch time
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+{
+  if (n >= numLEDs)
+    return;
+  if (brightness)
+  {
+    r = (r * brightness) >> 8;
+    g = (g * brightness) >> 8;
+    b = (b * brightness) >> 8;
+  }
+  uint8_t *p = &pixels[n * 3];
+  p[0] = r;
+  p[1] = g;
+  p[2] = b;
+}
+
+void Adafruit_NeoPixel::fill(uint32_t c, uint16_t first, uint16_t count)
+{
+  if (first >= numLEDs)
+    return;
+  uint16_t end = (count == 0) ? numLEDs : min<uint16_t>(first + count, numLEDs);
+  for (uint16_t i = first; i < end; i++)
+    setPixelColor(i, c);
+}
+
+// Same as the library: the stored pixels are rescaled, which is lossy when going down and back up.
+void Adafruit_NeoPixel::setBrightness(uint8_t b)
+{
+  uint8_t newBrightness = b + 1;
+  if (newBrightness == brightness)
+    return;
+  uint8_t oldBrightness = brightness - 1;
+  uint16_t scale;
+  if (oldBrightness == 0)
+    scale = 0;
+  else if (b == 255)
+    scale = 65535 / oldBrightness;
+  else
+    scale = (((uint16_t)newBrightness << 8) - 1) / oldBrightness;
+  for (uint16_t i = 0; i < numLEDs * 3; i++)
+    pixels[i] = (pixels[i] * scale) >> 8;
+  brightness = newBrightness;
+}
+
+void Adafruit_NeoPixel::clear()
+{
+  memset(pixels, 0, numLEDs * 3);
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const
+{
+  if (n >= numLEDs)
+    return 0;
+  const uint8_t *p = &pixels[n * 3];
+  if (brightness)
+    return (uint32_t((p[0] << 8) / brightness) << 16) | (uint32_t((p[1] << 8) / brightness) << 8) | ((p[2] << 8) / brightness);
+  return (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2];
+}
@@ -0,0 +1,76 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the Arduino core and the file system, see Arduino.h and FS.h.
+ */
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <Wire.h>
+#include <chrono>
+#include <thread>
+#include <sys/stat.h>
+#include <time.h>
+
+HardwareSerial Serial;
+LittleFSFS LittleFS;
+TwoWire Wire;
+TwoWire Wire1;
+uint8_t native_shift_register = 0xFF;
+double native_rtc_drift_ppm = 0;
+uint8_t native_pin_level[64] = {
+    HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+    HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+    HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+    HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH};
+
+uint32_t fs::File::reads = 0;
+uint32_t fs::File::seeks = 0;
+uint32_t fs::FS::opens = 0;
+
+static const std::chrono::steady_clock::time_point boot_time = std::chrono::steady_clock::now();
+static uint64_t skipped_us = 0;
+
+static uint64_t micros64()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot_time).count() +
+         skipped_us;
+}
+
+uint32_t millis() { return micros64() / 1000; }
+uint32_t micros() { return micros64(); }
+
+void native_skip_ms(uint32_t ms) { skipped_us += uint64_t(ms) * 1000; }
+
+uint64_t native_time_ms()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return uint64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000 + skipped_us / 1000;
+}
+
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+void yield() {}
+
+void randomSeed(unsigned long seed) { srand(seed); }
+long random(long howbig) { return howbig > 0 ? rand() % howbig : 0; }
+long random(long howsmall, long howbig) { return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall); }
+
+fs::File fs::FS::open(const char *path, const char *mode, bool create)
+{
+  opens++;
+  std::string full = root_ + path;
+  struct stat st;
+  if (stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    return File(nullptr, true);
+  std::string m = mode;
+  if (m.find('b') == std::string::npos)
+    m += 'b';
+  return File(fopen(full.c_str(), m.c_str()));
+}
+
+bool fs::FS::exists(const char *path)
+{
+  struct stat st;
+  return stat((root_ + path).c_str(), &st) == 0;
+}
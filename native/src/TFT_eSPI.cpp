@@ -0,0 +1,218 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the TFT_eSPI library, see TFT_eSPI.h.
+ */
+
+#include <TFT_eSPI.h>
+
+uint64_t TFT_eSPI::pixels_sent = 0;
+uint32_t TFT_eSPI::transactions = 0;
+uint16_t TFT_eSPI::panel[NUM_DIGITS][TFT_HEIGHT][TFT_WIDTH];
+
+uint8_t TFT_eSPI::selectedDisplays()
+{
+  // Same mapping as ChipSelect::update(): two dummy bits, CS lines are active low.
+  return (~(native_shift_register >> 2)) & 0x3F;
+}
+
+void TFT_eSPI::setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h)
+{
+  win_x0 = win_x = x;
+  win_y0 = win_y = y;
+  win_x1 = x + w - 1;
+  win_y1 = y + h - 1;
+  transactions++;
+}
+
+void TFT_eSPI::writeColor(uint16_t color)
+{
+  pixels_sent++;
+  if (win_x >= 0 && win_x < TFT_WIDTH && win_y >= 0 && win_y < TFT_HEIGHT)
+  {
+    uint8_t map = selectedDisplays();
+    for (uint8_t d = 0; d < NUM_DIGITS; d++)
+    {
+      if (map & (1 << d))
+        panel[d][win_y][win_x] = color;
+    }
+  }
+  if (++win_x > win_x1)
+  {
+    win_x = win_x0;
+    if (++win_y > win_y1)
+      win_y = win_y0;
+  }
+}
+
+void TFT_eSPI::pushPixels(const void *data_in, uint32_t len)
+{
+  const uint16_t *data = static_cast<const uint16_t *>(data_in);
+  while (len--)
+  {
+    uint16_t c = *data++;
+    writeColor(_swapBytes ? c : (uint16_t)((c << 8) | (c >> 8)));
+  }
+}
+
+void TFT_eSPI::pushBlock(uint16_t color, uint32_t len)
+{
+  while (len--)
+    writeColor(color);
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data)
+{
+  setAddrWindow(x, y, w, h);
+  pushPixels(data, w * h);
+}
+
+void TFT_eSPI::pushPixelsDMA(uint16_t *image, uint32_t len)
+{
+  if (_swapBytes) // the library swaps the buffer in place before sending it
+  {
+    for (uint32_t i = 0; i < len; i++)
+      image[i] = (image[i] << 8) | (image[i] >> 8);
+  }
+  bool swap = _swapBytes;
+  _swapBytes = false;
+  pushPixels(image, len);
+  _swapBytes = swap;
+}
+
+void TFT_eSPI::pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data, uint16_t *buffer)
+{
+  setAddrWindow(x, y, w, h);
+  pushPixelsDMA(data, w * h);
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  if (x < 0)
+  {
+    w += x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    h += y;
+    y = 0;
+  }
+  if (x + w > _width)
+    w = _width - x;
+  if (y + h > _height)
+    h = _height - y;
+  if (w < 1 || h < 1)
+    return;
+  setAddrWindow(x, y, w, h);
+  pushBlock(color, w * h);
+}
+
+int16_t TFT_eSPI::drawString(const char *string, int32_t x, int32_t y, uint8_t font)
+{
+  int16_t w = textWidth(string, font);
+  int16_t h = fontHeight(font);
+  if (textdatum == TC_DATUM || textdatum == MC_DATUM || textdatum == BC_DATUM)
+    x -= w / 2;
+  else if (textdatum == TR_DATUM || textdatum == MR_DATUM || textdatum == BR_DATUM)
+    x -= w;
+  if (textdatum >= ML_DATUM && textdatum <= MR_DATUM)
+    y -= h / 2;
+  else if (textdatum >= BL_DATUM)
+    y -= h;
+  fillRect(x, y, w, h, textbgcolor);
+  return w;
+}
+
+size_t TFT_eSPI::write(uint8_t c)
+{
+  if (c == '\n')
+  {
+    cursor_x = 0;
+    cursor_y += fontHeight();
+  }
+  else if (c != '\r')
+  {
+    // No fonts: the cell gets the background and a bar in the text color whose position depends on the character, so
+    // different text gives different pixels.
+    fillRect(cursor_x, cursor_y, charWidth(textfont), fontHeight(), textbgcolor);
+    if (c != ' ')
+      fillRect(cursor_x, cursor_y + c % fontHeight(), charWidth(textfont) - 1, 2, textcolor);
+    cursor_x += charWidth(textfont);
+  }
+  return 1;
+}
+
+// Same arithmetic as the library, so dimmed images compare bit exact.
+uint16_t TFT_eSPI::alphaBlend(uint8_t alpha, uint16_t fgc, uint16_t bgc)
+{
+  uint32_t rxb = bgc & 0xF81F;
+  rxb += ((fgc & 0xF81F) - rxb) * (alpha >> 2) >> 6;
+  uint32_t xgx = bgc & 0x07E0;
+  xgx += ((fgc & 0x07E0) - xgx) * alpha >> 8;
+  return (rxb & 0xF81F) | (xgx & 0x07E0);
+}
+
+void *TFT_eSprite::createSprite(int16_t w, int16_t h, uint8_t frames)
+{
+  deleteSprite();
+  _width = w;
+  _height = h;
+  _buffer = static_cast<uint8_t *>(calloc(w * h, _bpp == 16 ? 2 : 1));
+  return _buffer;
+}
+
+void TFT_eSprite::deleteSprite()
+{
+  free(_buffer);
+  _buffer = nullptr;
+}
+
+void *TFT_eSprite::setColorDepth(int8_t b)
+{
+  _bpp = (b == 16) ? 16 : 8;
+  if (_buffer)
+    return createSprite(_width, _height);
+  return nullptr;
+}
+
+// 8 bit sprites hold RRRGGGBB colours, 16 bit sprites hold byte swapped RGB565 - like the library.
+void TFT_eSprite::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  if (!_buffer)
+    return;
+  for (int32_t yy = max<int32_t>(y, 0); yy < min<int32_t>(y + h, _height); yy++)
+  {
+    for (int32_t xx = max<int32_t>(x, 0); xx < min<int32_t>(x + w, _width); xx++)
+    {
+      if (_bpp == 16)
+        reinterpret_cast<uint16_t *>(_buffer)[yy * _width + xx] = (color << 8) | ((color >> 8) & 0xFF);
+      else
+        _buffer[yy * _width + xx] = ((color & 0xE000) >> 8) | ((color & 0x0700) >> 6) | ((color & 0x0018) >> 3);
+    }
+  }
+}
+
+uint16_t TFT_eSprite::readPixel(int32_t x, int32_t y)
+{
+  if (!_buffer || x < 0 || y < 0 || x >= _width || y >= _height)
+    return 0;
+  if (_bpp == 16)
+  {
+    uint16_t c = reinterpret_cast<uint16_t *>(_buffer)[y * _width + x];
+    return (c << 8) | (c >> 8);
+  }
+  uint8_t c = _buffer[y * _width + x];
+  return ((c & 0xE0) << 8) | ((c & 0xC0) << 5) | ((c & 0x1C) << 6) | ((c & 0x1C) << 3) | ((c & 0x03) << 3) | ((c & 0x03) << 1) | (c & 0x01);
+}
+
+void TFT_eSprite::pushSprite(int32_t x, int32_t y)
+{
+  if (!_buffer)
+    return;
+  _tft->setAddrWindow(x, y, _width, _height);
+  for (int32_t yy = 0; yy < _height; yy++)
+  {
+    for (int32_t xx = 0; xx < _width; xx++)
+      _tft->pushBlock(readPixel(xx, yy), 1);
+  }
+}
@@ -0,0 +1,136 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the TimeLib (Time) library, see TimeLib.h.
+ */
+
+#include <TimeLib.h>
+
+static time_t sysTime = 0;
+static uint32_t prevMillis = 0;
+static time_t nextSyncTime = 0;
+static time_t syncInterval = 300; // seconds, library default
+static timeStatus_t Status = timeNotSet;
+static getExternalTime getTimePtr = nullptr;
+
+time_t now()
+{
+  // Same as the library: whole seconds are carried over from millis(), the remainder is kept.
+  while (millis() - prevMillis >= 1000)
+  {
+    sysTime++;
+    prevMillis += 1000;
+  }
+  if (nextSyncTime <= sysTime && getTimePtr != nullptr)
+  {
+    time_t t = getTimePtr();
+    if (t != 0)
+    {
+      setTime(t);
+    }
+    else
+    {
+      nextSyncTime = sysTime + syncInterval;
+      Status = (Status == timeNotSet) ? timeNotSet : timeNeedsSync;
+    }
+  }
+  return sysTime;
+}
+
+void setTime(time_t t)
+{
+  sysTime = t;
+  nextSyncTime = t + syncInterval;
+  Status = timeSet;
+  prevMillis = millis();
+}
+
+void setTime(int hr, int min, int sec, int dy, int mnth, int yr)
+{
+  tmElements_t tm;
+  tm.Year = (yr > 99) ? yr - 1970 : yr + 30;
+  tm.Month = mnth;
+  tm.Day = dy;
+  tm.Hour = hr;
+  tm.Minute = min;
+  tm.Second = sec;
+  setTime(makeTime(tm));
+}
+
+void adjustTime(long adjustment)
+{
+  sysTime += adjustment;
+}
+
+timeStatus_t timeStatus()
+{
+  now();
+  return Status;
+}
+
+void setSyncProvider(getExternalTime getTimeFunction)
+{
+  getTimePtr = getTimeFunction;
+  nextSyncTime = sysTime;
+  now();
+}
+
+void setSyncInterval(time_t interval)
+{
+  syncInterval = interval;
+  nextSyncTime = sysTime + syncInterval;
+}
+
+void breakTime(time_t time, tmElements_t &tm)
+{
+  struct tm t;
+  gmtime_r(&time, &t);
+  tm.Second = t.tm_sec;
+  tm.Minute = t.tm_min;
+  tm.Hour = t.tm_hour;
+  tm.Wday = t.tm_wday + 1;
+  tm.Day = t.tm_mday;
+  tm.Month = t.tm_mon + 1;
+  tm.Year = t.tm_year - 70;
+}
+
+time_t makeTime(const tmElements_t &tm)
+{
+  struct tm t = {};
+  t.tm_sec = tm.Second;
+  t.tm_min = tm.Minute;
+  t.tm_hour = tm.Hour;
+  t.tm_mday = tm.Day;
+  t.tm_mon = tm.Month - 1;
+  t.tm_year = tm.Year + 70;
+  return timegm(&t);
+}
+
+static tmElements_t cachedElements(time_t t)
+{
+  static time_t cacheTime = -1;
+  static tmElements_t tm;
+  if (t != cacheTime)
+  {
+    breakTime(t, tm);
+    cacheTime = t;
+  }
+  return tm;
+}
+
+int hour(time_t t) { return cachedElements(t).Hour; }
+int minute(time_t t) { return cachedElements(t).Minute; }
+int second(time_t t) { return cachedElements(t).Second; }
+int day(time_t t) { return cachedElements(t).Day; }
+int weekday(time_t t) { return cachedElements(t).Wday; }
+int month(time_t t) { return cachedElements(t).Month; }
+int year(time_t t) { return cachedElements(t).Year + 1970; }
+bool isAM(time_t t) { return !isPM(t); }
+bool isPM(time_t t) { return hour(t) >= 12; }
+
+int hourFormat12(time_t t)
+{
+  int h = hour(t);
+  if (h == 0)
+    return 12;
+  return h > 12 ? h - 12 : h;
+}
@@ -0,0 +1,60 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Host shim of the ESP32 WiFi library and the simulated NTP server, see WiFiUdp.h.
+ */
+
+#include <WiFi.h>
+
+WiFiClass WiFi;
+uint32_t native_ntp_delay_ms = 20;
+bool native_ntp_online = true;
+uint32_t WiFiUDP::requests = 0;
+
+static const uint32_t SECONDS_1900_TO_1970 = 2208988800UL;
+
+int WiFiUDP::endPacket()
+{
+  if (tx_port != 123 || tx_len != sizeof(tx))
+    return 1; // not NTP, sent into the void
+  requests++;
+  if (!native_ntp_online)
+    return 1;
+  pending = true;
+  answer_at = millis() + native_ntp_delay_ms;
+  server_ms = native_time_ms() + native_ntp_delay_ms / 2; // the server answers halfway through the round trip
+  return 1;
+}
+
+int WiFiUDP::parsePacket()
+{
+  if (!pending || (int32_t)(millis() - answer_at) < 0)
+    return 0;
+  pending = false;
+
+  uint32_t seconds = uint32_t(server_ms / 1000 + SECONDS_1900_TO_1970);
+  uint32_t fraction = uint32_t(((server_ms % 1000) << 32) / 1000);
+
+  // Server reply: LI 0, version 4, mode 4 (server), stratum 2. Reference, receive and transmit time stamps are "now".
+  memset(rx, 0, sizeof(rx));
+  rx[0] = 0x24;
+  rx[1] = 2;
+  rx[2] = tx[2];
+  rx[3] = 0xE9;
+  memcpy(rx + 24, tx + 40, 8); // originate time stamp = the client's transmit time stamp
+  for (uint8_t stamp = 16; stamp <= 40; stamp += 8)
+  {
+    if (stamp == 24)
+      continue;
+    rx[stamp] = seconds >> 24;
+    rx[stamp + 1] = seconds >> 16;
+    rx[stamp + 2] = seconds >> 8;
+    rx[stamp + 3] = seconds;
+    rx[stamp + 4] = fraction >> 24;
+    rx[stamp + 5] = fraction >> 16;
+    rx[stamp + 6] = fraction >> 8;
+    rx[stamp + 7] = fraction;
+  }
+  rx_len = sizeof(rx);
+  rx_pos = 0;
+  return rx_len;
+}
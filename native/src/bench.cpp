@@ -0,0 +1,727 @@
+/*
+ * Project: Alternative firmware for EleksTube IPS clock
+ * File description: Benchmark of the host ("native") build.
+ *   Takes the first clock face from the data directory, writes it again in every image format the firmware reads
+ *   (BMP 1/4/8/24 bit, or CLK v1 / v2 / v2 RLE / v2 palette when built with USE_CLK_FILES) and times the image decoder on them.
+ *   Then times a brightness sweep of the displays, the backlight patterns, the clock and the menu state machine.
+ *   Numbers are host CPU time, so only compare them with runs on the same machine. File system and bus
+ *   counters (reads, seeks, pixels, LED frames) are independent of the host.
+ *
+ *   Usage: program [data directory] [iterations]
+ */
+
+#include "GLOBAL_DEFINES.h"
+#include "TFTs.h"
+#include "Backlights.h"
+#include "Clock.h"
+#include "Buttons.h"
+#include "Menu.h"
+#include "StoredConfig.h"
+#include "WiFi_WPS.h"
+#include <RTClib.h>
+#include <algorithm>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TFTs tfts;
+Backlights backlights;
+Clock uclock;
+Buttons buttons;
+Menu menu;
+StoredConfig stored_config;
+extern RTC_DS3231 RTC;
+
+WifiState_t WifiState = connected;
+bool MQTTConnected = true;
+
+// Source image, RGB565, read straight from the data directory (independent of the decoder under test).
+struct SourceImage
+{
+  int16_t w = 0, h = 0;
+  std::vector<uint16_t> pixels;
+};
+
+static uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) { return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3); }
+
+static uint32_t le32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24); }
+
+static bool readSourceBmp(const std::string &path, SourceImage &img)
+{
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f)
+    return false;
+  std::vector<uint8_t> d;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    d.insert(d.end(), buf, buf + n);
+  fclose(f);
+  if (d.size() < 54 || d[0] != 'B' || d[1] != 'M')
+    return false;
+
+  uint32_t offset = le32(&d[10]), header = le32(&d[14]);
+  img.w = le32(&d[18]);
+  img.h = le32(&d[22]);
+  uint16_t bpp = d[28] | (d[29] << 8);
+  uint32_t colors = le32(&d[46]);
+  if (colors == 0)
+    colors = 1 << bpp;
+  const uint8_t *palette = &d[14 + header];
+  uint32_t line = ((bpp * img.w + 31) >> 5) * 4;
+  if (offset + line * img.h > d.size())
+    return false;
+
+  img.pixels.resize(img.w * img.h);
+  for (int16_t row = 0; row < img.h; row++)
+  {
+    const uint8_t *src = &d[offset + (img.h - 1 - row) * line];
+    for (int16_t col = 0; col < img.w; col++)
+    {
+      uint32_t index;
+      if (bpp == 24)
+      {
+        img.pixels[row * img.w + col] = rgb565(src[col * 3 + 2], src[col * 3 + 1], src[col * 3]);
+        continue;
+      }
+      else if (bpp == 8)
+        index = src[col];
+      else if (bpp == 4)
+        index = (src[col / 2] >> ((col & 1) ? 0 : 4)) & 0x0F;
+      else
+        index = (src[col / 8] >> (7 - (col & 7))) & 0x01;
+      const uint8_t *c = &palette[4 * index];
+      img.pixels[row * img.w + col] = rgb565(c[2], c[1], c[0]);
+    }
+  }
+  return true;
+}
+
+static void put16(std::vector<uint8_t> &d, uint16_t v)
+{
+  d.push_back(v);
+  d.push_back(v >> 8);
+}
+
+static void put32(std::vector<uint8_t> &d, uint32_t v)
+{
+  put16(d, v);
+  put16(d, v >> 16);
+}
+
+#ifndef USE_CLK_FILES
+static uint8_t red8(uint16_t c) { return ((c >> 11) & 0x1F) * 255 / 31; }
+static uint8_t green8(uint16_t c) { return ((c >> 5) & 0x3F) * 255 / 63; }
+static uint8_t blue8(uint16_t c) { return (c & 0x1F) * 255 / 31; }
+static uint8_t luma8(uint16_t c) { return (red8(c) * 77 + green8(c) * 150 + blue8(c) * 29) >> 8; }
+
+// Writes a BMP with the given depth. 8 bit uses a 3-3-2 palette, 4 bit 16 grey levels, 1 bit black and white.
+static std::vector<uint8_t> encodeBmp(const SourceImage &img, uint16_t bpp)
+{
+  uint32_t colors = bpp == 24 ? 0 : (1 << bpp);
+  uint32_t line = ((bpp * img.w + 31) >> 5) * 4;
+  uint32_t offset = 14 + 40 + colors * 4;
+  std::vector<uint8_t> d;
+  d.push_back('B');
+  d.push_back('M');
+  put32(d, offset + line * img.h);
+  put32(d, 0);
+  put32(d, offset);
+  put32(d, 40);
+  put32(d, img.w);
+  put32(d, img.h);
+  put16(d, 1);
+  put16(d, bpp);
+  put32(d, 0); // no compression
+  put32(d, line * img.h);
+  put32(d, 2835);
+  put32(d, 2835);
+  put32(d, colors);
+  put32(d, 0);
+  for (uint32_t i = 0; i < colors; i++)
+  {
+    uint8_t r, g, b;
+    if (bpp == 8)
+    {
+      r = (i >> 5) * 255 / 7;
+      g = ((i >> 2) & 7) * 255 / 7;
+      b = (i & 3) * 255 / 3;
+    }
+    else
+      r = g = b = i * 255 / (colors - 1);
+    d.push_back(b);
+    d.push_back(g);
+    d.push_back(r);
+    d.push_back(0);
+  }
+  for (int16_t row = img.h - 1; row >= 0; row--)
+  {
+    std::vector<uint8_t> out(line, 0);
+    for (int16_t col = 0; col < img.w; col++)
+    {
+      uint16_t c = img.pixels[row * img.w + col];
+      if (bpp == 24)
+      {
+        out[col * 3] = blue8(c);
+        out[col * 3 + 1] = green8(c);
+        out[col * 3 + 2] = red8(c);
+      }
+      else if (bpp == 8)
+        out[col] = (red8(c) & 0xE0) | ((green8(c) >> 3) & 0x1C) | (blue8(c) >> 6);
+      else if (bpp == 4)
+        out[col / 2] |= (luma8(c) >> 4) << ((col & 1) ? 0 : 4);
+      else
+        out[col / 8] |= (luma8(c) >= 128) << (7 - (col & 7));
+    }
+    d.insert(d.end(), out.begin(), out.end());
+  }
+  return d;
+}
+#endif
+
+#ifdef USE_CLK_FILES
+// Writes a CLK file, same layout as tools/conv-bmp-to-clk.py. version 1, or version 2 raw / RLE / palette.
+static std::vector<uint8_t> encodeClk(const SourceImage &img, uint8_t version, uint8_t compression)
+{
+  std::vector<uint8_t> d;
+  if (version == 1)
+  {
+    d.push_back('C');
+    d.push_back('K');
+    put16(d, img.w);
+    put16(d, img.h);
+    for (uint16_t c : img.pixels)
+      put16(d, c);
+    return d;
+  }
+
+  std::vector<uint16_t> palette;
+  if (compression == CLK_COMPRESSION_PALETTE)
+  {
+    for (uint16_t c : img.pixels)
+    {
+      if (std::find(palette.begin(), palette.end(), c) == palette.end())
+        palette.push_back(c);
+    }
+    if (palette.size() > 256)
+    {
+      palette.clear();
+      compression = CLK_COMPRESSION_RLE; // like the script
+    }
+  }
+
+  std::vector<std::vector<uint8_t>> rows(img.h);
+  for (int16_t row = 0; row < img.h; row++)
+  {
+    const uint16_t *p = &img.pixels[row * img.w];
+    std::vector<uint8_t> &out = rows[row];
+    if (compression == CLK_COMPRESSION_PALETTE)
+    {
+      for (int16_t col = 0; col < img.w; col++)
+        out.push_back(std::find(palette.begin(), palette.end(), p[col]) - palette.begin());
+      continue;
+    }
+    if (compression == CLK_COMPRESSION_NONE)
+    {
+      for (int16_t col = 0; col < img.w; col++)
+        put16(out, p[col]);
+      continue;
+    }
+    std::vector<uint16_t> literal;
+    auto flush = [&]()
+    {
+      for (size_t i = 0; i < literal.size(); i += 128)
+      {
+        size_t n = std::min<size_t>(128, literal.size() - i);
+        out.push_back(n - 1);
+        for (size_t j = 0; j < n; j++)
+          put16(out, literal[i + j]);
+      }
+      literal.clear();
+    };
+    for (int16_t col = 0; col < img.w;)
+    {
+      int16_t run = 1;
+      while (col + run < img.w && p[col + run] == p[col] && run < 128)
+        run++;
+      if (run >= 2)
+      {
+        flush();
+        out.push_back(0x80 | (run - 1));
+        put16(out, p[col]);
+      }
+      else
+        literal.push_back(p[col]);
+      col += run;
+    }
+    flush();
+  }
+
+  d.push_back('C');
+  d.push_back('2');
+  d.push_back(2);
+  d.push_back(compression);
+  put16(d, img.w);
+  put16(d, img.h);
+  put32(d, 0);
+  uint32_t offset = CLK_V2_HEADER_SIZE + 4 * img.h + (palette.empty() ? 0 : 2 + 2 * palette.size());
+  for (const auto &row : rows)
+  {
+    put32(d, offset);
+    offset += row.size();
+  }
+  if (!palette.empty())
+  {
+    put16(d, palette.size());
+    for (uint16_t c : palette)
+      put16(d, c);
+  }
+  for (const auto &row : rows)
+    d.insert(d.end(), row.begin(), row.end());
+  return d;
+}
+#endif
+
+// Has access to the private decoder of TFTs, see the friend declaration in TFTs.h.
+class NativeBench
+{
+public:
+#ifndef TFT_BAND_ROWS
+  static uint8_t imageBuffers() { return tfts.NumberOfImageBuffers; }
+#endif
+  static bool load(uint8_t file_index)
+  {
+#ifdef TFT_BAND_ROWS
+    tfts.InvalidateDisplayRows(0); // no image buffer: decoded straight to the first display
+    return tfts.DrawImageBands(0, file_index);
+#else
+    tfts.InvalidateImageInBuffer();
+    return tfts.LoadImageIntoBuffer(file_index, 0);
+#endif
+  }
+#ifdef DIGIT_TRANSITION
+  static bool transitionsRunning()
+  {
+    for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+      if (tfts.Transitions[digit].active)
+        return true;
+    return false;
+  }
+  static uint8_t plannedFrames(uint8_t digit) { return tfts.Transitions[digit].frames; }
+  static uint32_t pixelTimeNs() { return tfts.PixelTimeNs; }
+#endif
+};
+
+struct ImageSet
+{
+  const char *name;
+  uint8_t param1, param2;
+};
+
+static void benchImages(const std::string &data_dir, uint32_t iterations)
+{
+  SourceImage source[10];
+  for (uint8_t digit = 0; digit < 10; digit++)
+  {
+    if (!readSourceBmp(data_dir + "/" + std::to_string(10 + digit) + ".bmp", source[digit]))
+    {
+      printf("Can't read %s/%d.bmp, skipping the image benchmark.\n", data_dir.c_str(), 10 + digit);
+      return;
+    }
+  }
+
+#ifdef USE_CLK_FILES
+  const ImageSet sets[] = {{"CLK v1", 1, CLK_COMPRESSION_NONE}, {"CLK v2", 2, CLK_COMPRESSION_NONE}, {"CLK v2 RLE", 2, CLK_COMPRESSION_RLE},
+                            {"CLK v2 pal", 2, CLK_COMPRESSION_PALETTE}};
+#else
+  const ImageSet sets[] = {{"BMP 1 bit", 1, 0}, {"BMP 4 bit", 4, 0}, {"BMP 8 bit", 8, 0}, {"BMP 24 bit", 24, 0}};
+#endif
+
+  char tmp_template[] = "/tmp/elekstube_bench_XXXXXX";
+  std::string tmp_dir = mkdtemp(tmp_template);
+
+#ifdef TFT_BAND_ROWS
+  printf("\nImage decoding and sending in bands of %d rows (DrawImageBands), %u x 10 images per set\n", TFT_BAND_ROWS, iterations);
+#else
+  printf("\nImage decoding (LoadImageIntoBuffer), %u x 10 images per set\n", iterations);
+#endif
+  printf("%-12s %10s %10s %10s %8s %8s\n", "format", "bytes/img", "us/img", "min us", "reads", "seeks");
+  for (const ImageSet &set : sets)
+  {
+    std::string dir = tmp_dir + "/" + std::to_string(&set - sets);
+    mkdir(dir.c_str(), 0700);
+    uint32_t total_bytes = 0;
+    for (uint8_t digit = 0; digit < 10; digit++)
+    {
+#ifdef USE_CLK_FILES
+      std::vector<uint8_t> file = encodeClk(source[digit], set.param1, set.param2);
+#else
+      std::vector<uint8_t> file = encodeBmp(source[digit], set.param1);
+#endif
+      std::string path = dir + "/" + std::to_string(10 + digit) + "." IMAGE_FILE_EXTENSION;
+      FILE *f = fopen(path.c_str(), "wb");
+      fwrite(file.data(), 1, file.size(), f);
+      fclose(f);
+      total_bytes += file.size();
+    }
+    LittleFS.setRoot(dir.c_str());
+
+    uint32_t reads = fs::File::reads, seeks = fs::File::seeks;
+    uint32_t best = UINT32_MAX;
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+      for (uint8_t digit = 0; digit < 10; digit++)
+      {
+        uint32_t start = micros();
+        if (!NativeBench::load(10 + digit))
+        {
+          printf("%s: loading image %d failed.\n", set.name, 10 + digit);
+          return;
+        }
+        uint32_t t = micros() - start;
+        total += t;
+        best = min(best, t);
+      }
+    }
+    uint32_t loads = iterations * 10;
+    printf("%-12s %10u %10.1f %10u %8.1f %8.1f\n", set.name, total_bytes / 10, double(total) / loads, best,
+           double(fs::File::reads - reads) / loads, double(fs::File::seeks - seeks) / loads);
+    for (uint8_t digit = 0; digit < 10; digit++)
+      remove((dir + "/" + std::to_string(10 + digit) + "." IMAGE_FILE_EXTENSION).c_str());
+    rmdir(dir.c_str());
+  }
+  rmdir(tmp_dir.c_str());
+  LittleFS.setRoot(data_dir.c_str());
+}
+
+// Brightness slider moved from full to dark in 16 steps, every step redraws all digits like main.cpp does.
+static void benchBrightness(uint32_t iterations)
+{
+  tfts.begin();
+  tfts.EnablePrefetchBuffers(); // like main.cpp once the network is up
+  if (tfts.NumberOfClockFaces == 0)
+  {
+    printf("\nNo clock faces in the data directory, skipping the brightness sweep.\n");
+    return;
+  }
+  tfts.current_graphic = 1;
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+    tfts.setDigit(digit, digit + 1, TFTs::force);
+  tfts.WaitForImageTransfer();
+
+  uint32_t opens = fs::FS::opens, reads = fs::File::reads;
+  uint64_t pixels = TFT_eSPI::pixels_sent;
+  uint32_t steps = 0;
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    for (int16_t level = 255; level > 0; level -= 16, steps++)
+    {
+      tfts.dimming = level;
+      tfts.ProcessUpdatedDimming();
+      for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+        tfts.setDigit(digit, tfts.getDigit(digit), TFTs::force);
+      tfts.WaitForImageTransfer();
+    }
+  }
+  uint32_t t = micros() - start;
+  printf("\nBrightness sweep, %u changes, all digits redrawn\n", steps);
+  printf("%.1f us/change, file opens %.1f, reads %.1f, pixels sent %.0f per change\n", double(t) / steps,
+         double(fs::FS::opens - opens) / steps, double(fs::File::reads - reads) / steps, double(TFT_eSPI::pixels_sent - pixels) / steps);
+  tfts.dimming = 255;
+  tfts.ProcessUpdatedDimming();
+}
+
+// All digits change to the same value (00:00:00, 11:11:11, ...): one by one with setDigit(), then together with setDigits().
+static void benchRepeatedDigits(uint32_t iterations)
+{
+  if (tfts.NumberOfClockFaces == 0)
+    return;
+  printf("\nAll digits the same, %u x 10 changes\n", iterations);
+  for (uint8_t grouped = 0; grouped < 2; grouped++)
+  {
+    uint64_t pixels = TFT_eSPI::pixels_sent;
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+      for (uint8_t value = 0; value < 10; value++)
+      {
+        uint8_t values[NUM_DIGITS];
+        for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+          values[digit] = value;
+        if (grouped)
+          tfts.setDigits(values);
+        else
+          for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+            tfts.setDigit(digit, value);
+        tfts.WaitForImageTransfer();
+      }
+    }
+    uint32_t t = micros() - start;
+    printf("%-10s %.1f us/change, pixels sent %.0f per change\n", grouped ? "setDigits" : "setDigit", double(t) / (iterations * 10),
+           double(TFT_eSPI::pixels_sent - pixels) / (iterations * 10));
+  }
+}
+
+#ifndef TFT_BAND_ROWS
+// The clock runs through the last seconds of every hour into the next one, like updateClockDisplay() in the main loop.
+// Counts the files opened by the updates themselves, with and without LoadNextImage() in the free time in between.
+static void benchPrefetch(uint32_t iterations)
+{
+  if (tfts.NumberOfClockFaces == 0)
+    return;
+  printf("\nSecond updates around full hours, %u image buffers\n", NativeBench::imageBuffers());
+  for (uint8_t prefetch = 0; prefetch < 2; prefetch++)
+  {
+    tfts.InvalidateImageInBuffer();
+    uint32_t updates = 0, opens = 0, full_hours = 0, full_hour_opens = 0, longest = 0;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+      uint32_t first = (i % 24) * 3600 + 3600 - 4; // hh:59:56 .. hh+1:00:01
+      for (uint32_t t = first; t < first + 6; t++)
+      {
+        uint8_t values[2][NUM_DIGITS];
+        for (uint8_t n = 0; n < 2; n++)
+        {
+          uint32_t s = (t + n) % 86400;
+          values[n][SECONDS_ONES] = s % 10;
+          values[n][SECONDS_TENS] = s / 10 % 6;
+          values[n][MINUTES_ONES] = s / 60 % 10;
+          values[n][MINUTES_TENS] = s / 600 % 6;
+          values[n][HOURS_ONES] = s / 3600 % 10;
+          values[n][HOURS_TENS] = s / 36000;
+        }
+        uint32_t opened = fs::FS::opens, start = micros();
+        for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+          tfts.setDigit(digit, values[0][digit]);
+        tfts.WaitForImageTransfer();
+        if (t != first) // the first one draws all digits
+        {
+          updates++;
+          opens += fs::FS::opens - opened;
+          longest = max(longest, micros() - start);
+          if (t % 3600 == 0)
+          {
+            full_hours++;
+            full_hour_opens += fs::FS::opens - opened;
+          }
+        }
+        tfts.PlanPrefetch(values[1], 1000);
+        for (uint8_t loops = 0; prefetch && loops < 10; loops++)
+          tfts.LoadNextImage();
+      }
+    }
+    printf("%-12s file opens per update %.2f, at the full hour %.2f, longest update %u us\n", prefetch ? "prefetch" : "no prefetch",
+           double(opens) / updates, double(full_hour_opens) / full_hours, longest);
+  }
+}
+#endif
+
+#ifdef DIGIT_TRANSITION
+// All digits change at once, like at midnight, and the main loop calls RenderTransitions() every 20 ms.
+static void benchTransitions(uint32_t iterations)
+{
+  static const char *names[] = {"instant", "crossfade", "slide", "flip"};
+  printf("\nDigit transitions (%s), all digits change, %u times\n", names[tfts.transition], iterations);
+  uint32_t longest_call = 0, longest_transition = 0, loops = 0;
+  uint64_t pixels = TFT_eSPI::pixels_sent;
+  uint8_t frames = 0;
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+      tfts.setDigit(digit, (i + 1) % 10);
+    frames = NativeBench::plannedFrames(SECONDS_ONES);
+    uint32_t start = millis();
+    while (NativeBench::transitionsRunning())
+    {
+      uint32_t call = micros();
+      tfts.RenderTransitions();
+      longest_call = max(longest_call, micros() - call);
+      loops++;
+      delay(20);
+    }
+    longest_transition = max(longest_transition, millis() - start);
+  }
+  printf("frames planned: %u, longest RenderTransitions(): %u us, all done after max. %u ms (transition time %u ms)\n", frames,
+         longest_call, longest_transition, DIGIT_TRANSITION_MS);
+  printf("loops per change %.1f, pixels sent per change %.0f, measured %u ns per pixel\n", double(loops) / iterations,
+         double(TFT_eSPI::pixels_sent - pixels) / iterations, NativeBench::pixelTimeNs());
+}
+#endif
+
+// Every pattern for iterations simulated seconds, with loop() called every 5 ms like from the main loop. Then the
+// animated ones dimmed, where the low values are dithered.
+static void benchBacklights(uint32_t iterations)
+{
+  const uint32_t calls = iterations * 200;
+  backlights.begin(&stored_config.config.backlights);
+  printf("\nBacklights::loop(), %u calls per pattern, 5 ms apart (%u s)\n", calls, iterations);
+  printf("%-10s %8s %8s %8s %9s %12s\n", "pattern", "us/loop", "frames", "skipped", "refreshes", "wire us");
+  for (uint8_t run = 0; run < 2; run++)
+  {
+    backlights.setDimming(run == 1);
+    for (uint8_t p = 0; p < Backlights::num_patterns; p++)
+    {
+      if (run == 1 && p != Backlights::rainbow && p != Backlights::pulse && p != Backlights::breath)
+        continue;
+      backlights.setPattern(Backlights::patterns(p));
+      uint32_t sent = backlights.getFramesSent();
+      uint32_t skipped = backlights.getFramesSkipped();
+      uint32_t refreshes = backlights.getRefreshes();
+      uint64_t wire = Adafruit_NeoPixel::wire_time_us;
+      uint32_t t = 0;
+      for (uint32_t i = 0; i < calls; i++)
+      {
+        uint32_t start = micros();
+        backlights.loop();
+        t += micros() - start;
+        native_skip_ms(5);
+      }
+      String name = Backlights::patterns_str[p] + (run == 1 ? " dim" : "");
+      printf("%-10s %8.3f %8u %8u %9u %12llu\n", name.c_str(), double(t) / calls, backlights.getFramesSent() - sent,
+             backlights.getFramesSkipped() - skipped, backlights.getRefreshes() - refreshes,
+             (unsigned long long)(Adafruit_NeoPixel::wire_time_us - wire));
+    }
+  }
+  backlights.setDimming(false);
+
+  // The effect programs alone, for the 34 LEDs of the IPSTube with LED strip, against the frame budget.
+  const uint16_t leds = 34;
+  const char *programs[] = {BacklightEffect::chase_program, BacklightEffect::comet_program, BacklightEffect::seconds_program};
+  const char *names[] = {"Chase", "Comet", "Seconds"};
+  printf("\nBacklightEffect::eval(), %u LEDs, %u frames per effect, budget %u us per frame\n", leds, iterations * 1000,
+         BACKLIGHT_EFFECT_BUDGET_US);
+  printf("%-10s %6s %10s\n", "effect", "bytes", "us/frame");
+  for (uint8_t e = 0; e < 3; e++)
+  {
+    BacklightEffect effect;
+    effect.load(programs[e]);
+    uint32_t sum = 0;
+    uint32_t start = micros();
+    for (uint32_t frame = 0; frame < iterations * 1000; frame++)
+      for (uint16_t led = 0; led < leds; led++)
+        sum += effect.eval(led, leds, frame * 97, frame * 13).level;
+    uint32_t t = micros() - start;
+    printf("%-10s %6u %10.3f%s\n", names[e], effect.getCodeLength(), double(t) / (iterations * 1000), sum ? "" : " (all dark)");
+  }
+}
+
+// loop() and idle() like the main loop, for ms.
+static void runClock(uint32_t ms)
+{
+  uint32_t start = millis();
+  while (millis() - start < ms)
+  {
+    uclock.loop();
+    uclock.idle(min<uint32_t>(20, uclock.getMillisToNextSecond()));
+  }
+}
+
+static void benchClock(uint32_t iterations)
+{
+  printf("\nClock\n");
+  native_rtc_drift_ppm = 40;
+  uint32_t start = micros();
+  uclock.begin(&stored_config.config.uclock, &stored_config.config.rtc); // TimeLib calls the sync provider right away: RTC time, NTP request sent
+  uint32_t first = micros() - start;
+
+  // loop() every 20 ms like the main loop, until the NTP answer is applied.
+  uint32_t longest = 0, loops = 0;
+  start = micros();
+  while (!Clock::isNtpSynced() && micros() - start < 2000000)
+  {
+    uint32_t call = micros();
+    uclock.loop();
+    longest = std::max(longest, micros() - call);
+    loops++;
+    delay(20);
+  }
+  uint32_t synced = micros() - start;
+
+  start = micros();
+  for (uint32_t i = 0; i < iterations * 1000; i++)
+    uclock.loop();
+  uint32_t t = micros() - start;
+  printf("begin: %u us, NTP answer %s after %u us (%u loops, longest loop() %u us), then %.3f us/loop\n", first,
+         Clock::isNtpSynced() ? "applied" : "NOT applied", synced, loops, longest, double(t) / (iterations * 1000));
+  printf("time %02d:%02d:%02d UTC%+ld, NTP requests %u\n", uclock.getHour24(), uclock.getMinute(), uclock.getSecond(),
+         long(uclock.getTimeZoneOffset() / 3600), WiFiUDP::requests);
+
+  // RTC drift: the simulated RTC runs native_rtc_drift_ppm fast. A few syncs, hours apart, teach the clock its drift,
+  // then a day without NTP shows the RTC time TimeLib gets, with and without the correction.
+  const uint8_t syncs = 3;
+  const uint32_t hours_between = 3;
+  runClock(2100); // the first sync sets the RTC at the next second
+  for (uint8_t sync = 0; sync < syncs; sync++)
+  {
+    native_skip_ms(hours_between * 3600000);
+    Clock::requestNtpSync();
+    runClock(2100); // answer, the RTC's next second, and setting the RTC again if it is too far off
+  }
+  printf("RTC drift: simulated %+.3f ppm, learned %+.3f ppm from %u syncs %u hours apart\n", native_rtc_drift_ppm,
+         Clock::getRtcDriftPpb() / 1000.0, Clock::getRtcDriftSyncs(), hours_between);
+  native_ntp_online = false;
+  native_skip_ms(24 * 3600000);
+  int64_t host_ms = native_time_ms();
+  long rtc_error = long(RTC.now().unixtime() - host_ms / 1000);
+  long corrected_error = long(now() - host_ms / 1000); // TimeLib syncs, it gets the corrected RTC time
+  printf("1 day without NTP: RTC %+ld s off, corrected %+ld s\n", rtc_error, corrected_error);
+  native_ntp_online = true;
+}
+
+static void benchMenu(uint32_t iterations)
+{
+  printf("\nMenu\n");
+  buttons.begin();
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < iterations * 1000; i++)
+  {
+    buttons.loop();
+    menu.loop(buttons);
+  }
+  uint32_t idle = micros() - start;
+
+  // Walk once through all menu entries with the mode button.
+  uint8_t changes = 0;
+  for (uint8_t step = 0; step < Menu::num_states; step++)
+  {
+    native_pin_level[BUTTON_MODE_PIN] = LOW;
+    buttons.loop();
+    menu.loop(buttons);
+    changes += menu.stateChanged();
+    native_pin_level[BUTTON_MODE_PIN] = HIGH;
+    buttons.loop();
+    menu.loop(buttons);
+  }
+  printf("idle: %.3f us/loop, walk through the menu: %u state changes, now in \"%s\"\n", double(idle) / (iterations * 1000),
+         changes, menu.getStateStr().c_str());
+}
+
+int main(int argc, char **argv)
+{
+  std::string data_dir = argc > 1 ? argv[1] : "data";
+  uint32_t iterations = argc > 2 ? atoi(argv[2]) : 20;
+  if (iterations == 0)
+    iterations = 1;
+
+  Serial.enabled = false; // keep the firmware's log out of the results
+  LittleFS.setRoot(data_dir.c_str());
+  stored_config.begin();
+  stored_config.load();
+
+  printf("EleksTubeHAX native benchmark, " IMAGE_FILE_TYPE " build, data: %s\n", data_dir.c_str());
+  benchImages(data_dir, iterations);
+  benchBrightness(iterations);
+  benchRepeatedDigits(iterations);
+#ifndef TFT_BAND_ROWS
+  benchPrefetch(iterations);
+#endif
+#ifdef DIGIT_TRANSITION
+  benchTransitions(iterations);
+#endif
+  benchBacklights(iterations);
+  benchClock(iterations);
+  benchMenu(iterations);
+  return 0;
+}
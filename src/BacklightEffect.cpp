@@ -0,0 +1,193 @@
+#include "BacklightEffect.h"
+#include "Waveform.h"
+#include <ctype.h>
+#include <string.h>
+
+const char BacklightEffect::chase_program[] = "01C800 02 03 06 0A 12 0E";                            // frac(pos - time) < unit
+const char BacklightEffect::comet_program[] = "019600 03 02 06 0A 0B 0F 07 0F 07";                   // (1 - frac(time - pos))^4
+const char BacklightEffect::seconds_program[] = "010000 02 04 0E 01 40 07 04 02 06 0A 12 0E 09"; // dim up to the hand, the hand full
+
+static int8_t hexDigit(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  c = toupper(c);
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+bool BacklightEffect::load(const char *hex)
+{
+  uint8_t data[3 + max_code];
+  uint8_t length = 0;
+  for (const char *p = hex; *p != '\0' && *p != '\n' && *p != '\r'; p++)
+  {
+    if (*p == ' ')
+      continue;
+    int8_t high = hexDigit(p[0]);
+    int8_t low = p[1] != '\0' ? hexDigit(p[1]) : -1;
+    if (high < 0 || low < 0 || length == sizeof(data))
+      return false;
+    data[length++] = high << 4 | low;
+    p++;
+  }
+  if (length < 4 || data[0] != version)
+    return false;
+
+  // Simulate the stack depth.
+  const uint8_t *new_code = data + 3;
+  uint8_t new_length = length - 3;
+  int8_t depth = 0;
+  for (uint8_t pc = 0; pc < new_length; pc++)
+  {
+    switch (new_code[pc])
+    {
+    case op_push:
+      if (++pc == new_length)
+        return false;
+      // fall through
+    case op_pos:
+    case op_time:
+    case op_second:
+    case op_unit:
+      depth++;
+      break;
+    case op_dup:
+      if (depth < 1)
+        return false;
+      depth++;
+      break;
+    case op_add:
+    case op_sub:
+    case op_mul:
+    case op_min:
+    case op_max:
+    case op_step:
+      if (depth < 2)
+        return false;
+      depth--;
+      break;
+    case op_swap:
+      if (depth < 2)
+        return false;
+      break;
+    case op_frac:
+    case op_inv:
+    case op_tri:
+    case op_wave:
+      if (depth < 1)
+        return false;
+      break;
+    case op_hue:
+      if (depth < 1)
+        return false;
+      depth--;
+      break;
+    default:
+      return false;
+    }
+    if (depth > max_stack)
+      return false;
+  }
+  if (depth < 1)
+    return false;
+
+  period_10ms = data[1] | data[2] << 8;
+  memcpy(code, new_code, new_length);
+  code_length = new_length;
+  return true;
+}
+
+// Results of the arithmetic are kept within +-max_value, so no program can overflow the stack values.
+static inline int32_t saturate(int64_t value)
+{
+  if (value > BacklightEffect::max_value)
+    return BacklightEffect::max_value;
+  if (value < -BacklightEffect::max_value)
+    return -BacklightEffect::max_value;
+  return value;
+}
+
+BacklightEffect::Pixel BacklightEffect::eval(uint16_t led, uint16_t count, uint16_t time, uint16_t second) const
+{
+  int32_t stack[max_stack];
+  int8_t top = -1;
+  Pixel pixel = {0, -1};
+  int32_t a;
+  for (uint8_t pc = 0; pc < code_length; pc++)
+  {
+    switch (code[pc])
+    {
+    case op_push:
+      stack[++top] = code[++pc] * 257;
+      break;
+    case op_pos:
+      stack[++top] = (uint32_t(led) << 16) / count;
+      break;
+    case op_time:
+      stack[++top] = time;
+      break;
+    case op_second:
+      stack[++top] = second;
+      break;
+    case op_unit:
+      stack[++top] = 65536 / count;
+      break;
+    case op_dup:
+      stack[top + 1] = stack[top];
+      top++;
+      break;
+    case op_add:
+      a = stack[top--];
+      stack[top] = saturate(int64_t(stack[top]) + a);
+      break;
+    case op_sub:
+      a = stack[top--];
+      stack[top] = saturate(int64_t(stack[top]) - a);
+      break;
+    case op_mul:
+      a = stack[top--];
+      stack[top] = saturate((int64_t(stack[top]) * a) >> 16);
+      break;
+    case op_min:
+      a = stack[top--];
+      if (a < stack[top])
+        stack[top] = a;
+      break;
+    case op_max:
+      a = stack[top--];
+      if (a > stack[top])
+        stack[top] = a;
+      break;
+    case op_step:
+      a = stack[top--];
+      stack[top] = stack[top] < a ? 65535 : 0;
+      break;
+    case op_swap:
+      a = stack[top];
+      stack[top] = stack[top - 1];
+      stack[top - 1] = a;
+      break;
+    case op_frac:
+      stack[top] &= 0xFFFF;
+      break;
+    case op_inv:
+      stack[top] = 65535 - stack[top];
+      break;
+    case op_tri:
+      a = stack[top] & 0xFFFF;
+      stack[top] = a < 0x8000 ? a * 2 : (0xFFFF - a) * 2;
+      break;
+    case op_wave:
+      stack[top] = Waveform::absSine(uint32_t(stack[top] & 0xFFFF) << 15) * 257;
+      break;
+    case op_hue:
+      pixel.hue = stack[top--] & 0xFFFF;
+      break;
+    }
+  }
+  a = stack[top];
+  pixel.level = a < 0 ? 0 : a > 65535 ? 65535 : a;
+  return pixel;
+}
@@ -1,8 +1,36 @@
 #include "Backlights.h"
+#include "Clock.h"
+#include <LittleFS.h>
 
-void Backlights::begin(StoredConfig::Config::Backlights *config_)
+#ifndef NATIVE_BUILD
+#include <driver/rmt.h>
+#include <esp_timer.h>
+
+// next_frame is written by loop() and read by the refresh timer.
+static portMUX_TYPE output_mux = portMUX_INITIALIZER_UNLOCKED;
+#define OUTPUT_LOCK() portENTER_CRITICAL(&output_mux)
+#define OUTPUT_UNLOCK() portEXIT_CRITICAL(&output_mux)
+#else
+#define OUTPUT_LOCK()
+#define OUTPUT_UNLOCK()
+#endif
+
+// WS2812 bit timings in RMT ticks of 25 ns (80 MHz APB clock divided by 2): 0.4 + 0.85 us for a 0, 0.8 + 0.45 us for a 1.
+#define WS2812_T0H 16
+#define WS2812_T0L 34
+#define WS2812_T1H 32
+#define WS2812_T1L 18
+#define WS2812_LATCH_US 300 // low time after a frame before the next one, the WS2812B needs 280 us
+
+#ifndef NATIVE_BUILD
+// One RMT item per bit. Must not change while the RMT sends it, so there is one for the whole strip.
+static rmt_item32_t rmt_items[NUM_BACKLIGHT_LEDS * 24];
+#endif
+
+void Backlights::begin(StoredConfig::Config::Backlights *config_, Clock *clock_)
 {
   config = config_;
+  clock = clock_;
 
   if (config->is_valid != StoredConfig::valid)
   {
@@ -18,6 +46,8 @@ void Backlights::begin(StoredConfig::Config::Backlights *config_)
     config->is_valid = StoredConfig::valid;
   }
   off = false;
+
+  beginOutput();
 }
 
 // These feel like they should be generalizable into a helper function.
@@ -55,19 +85,45 @@ void Backlights::adjustIntensity(int16_t adj)
 void Backlights::setIntensity(uint8_t intensity)
 {
   config->intensity = intensity;
-  setBrightness(0xFF >> max_intensity - config->intensity - 1);
+  applyIntensity();
   pattern_needs_init = true;
 }
 
+// Brightness of the patterns with a fixed brightness: halved for every intensity step below the maximum.
+void Backlights::applyIntensity()
+{
+  if (dimming)
+  {
+#if BACKLIGHT_DIMMED_INTENSITY > 0
+    setBrightness(0xFF >> (max_intensity - BACKLIGHT_DIMMED_INTENSITY - 1));
+#else // turn off backlight if intensity is 0
+    setBrightness(0);
+#endif
+  }
+  else
+  {
+    setBrightness(0xFF >> (max_intensity - config->intensity - 1));
+  }
+}
+
 void Backlights::loop()
 {
-  //   enum patterns { dark, test, constant, rainbow, pulse, breath, num_patterns };
+  if (!timer_running)
+    refreshOutput();
+  if (!pattern_needs_init)
+  {
+    if (millis() - last_frame_ms < frame_interval_ms)
+      return; // frame rate cap
+  }
+  last_frame_ms = millis();
+
+  //   enum patterns { dark, test, constant, rainbow, pulse, breath, chase, comet, seconds, custom, num_patterns };
   if (off || config->pattern == dark)
   {
     if (pattern_needs_init)
     {
       clear();
-      show();
+      sendFrame();
     }
   }
   else if (config->pattern == test)
@@ -80,15 +136,8 @@ void Backlights::loop()
     {
       fill(phaseToColor(config->color_phase));
     }
-    if (dimming)
-    {
-      setBrightness(0xFF >> max_intensity - BACKLIGHT_DIMMED_INTENSITY - 1);
-    }
-    else
-    {
-      setBrightness(0xFF >> max_intensity - config->intensity - 1);
-    }
-    show();
+    applyIntensity();
+    sendFrame();
   }
   else if (config->pattern == rainbow)
   {
@@ -102,6 +151,10 @@ void Backlights::loop()
   {
     breathPattern();
   }
+  else if (config->pattern >= chase && config->pattern <= custom)
+  {
+    effectPattern();
+  }
 
   pattern_needs_init = false;
 }
@@ -110,8 +163,8 @@ void Backlights::pulsePattern()
 {
   fill(phaseToColor(config->color_phase));
 
-  float pulse_length_millis = (60.0f * 1000) / config->pulse_bpm;
-  float val = 1 + abs(sin(2 * M_PI * millis() / pulse_length_millis)) * 254;
+  uint32_t pulse_length_us = config->pulse_bpm ? 60000000UL / config->pulse_bpm : 0;
+  uint16_t val = 1 + (Waveform::absSine(wave.advance(micros(), pulse_length_us)) * 254 + 127) / 255;
   if (dimming)
   {
     val = val * BACKLIGHT_DIMMED_INTENSITY / 7;
@@ -122,17 +175,16 @@ void Backlights::pulsePattern()
   }
   setBrightness((uint8_t)val);
 
-  show();
+  sendFrame();
 }
 
 void Backlights::breathPattern()
 {
   fill(phaseToColor(config->color_phase));
 
-  // https://sean.voisen.org/blog/2011/10/breathing-led-with-arduino/
   // Avoid a 0 value as it shuts off the LEDs and we have to re-initialize.
-  float pulse_length_millis = (60.0f * 1000) / config->breath_per_min;
-  float val = (exp(sin(2 * M_PI * millis() / pulse_length_millis)) - 0.36787944f) * 108.0f;
+  uint32_t pulse_length_us = config->breath_per_min ? 60000000UL / config->breath_per_min : 0;
+  uint16_t val = Waveform::breath(wave.advance(micros(), pulse_length_us));
 
   if (dimming)
   {
@@ -150,7 +202,7 @@ void Backlights::breathPattern()
   }
   setBrightness(brightness);
 
-  show();
+  sendFrame();
 }
 
 void Backlights::testPattern()
@@ -165,16 +217,9 @@ void Backlights::testPattern()
   clear();
   setPixelColor(digit, color);
 
-  if (dimming)
-  {
-    setBrightness(0xFF >> max_intensity - (uint8_t)BACKLIGHT_DIMMED_INTENSITY - 1);
-  }
-  else
-  {
-    setBrightness(0xFF >> max_intensity - config->intensity - 1);
-  }
+  applyIntensity();
 
-  show();
+  sendFrame();
 }
 
 uint8_t Backlights::phaseToIntensity(uint16_t phase)
@@ -240,8 +285,8 @@ void Backlights::rainbowPattern()
   const uint16_t phase_per_digit = (max_phase / NUM_BACKLIGHT_LEDS) / 3;
 
   // Rainbow roatation speed now configurable
-  uint16_t duration = uint16_t(round(getRainbowDuration() * 1000));
-  uint16_t phase = uint16_t(round(float(millis() % duration) / duration * max_phase));
+  uint32_t duration_us = uint32_t(getRainbowDuration() * 1000000);
+  uint16_t phase = (uint64_t(wave.advance(micros(), duration_us)) * max_phase) >> 32;
 
   for (uint8_t digit = 0; digit < NUM_BACKLIGHT_LEDS; digit++)
   {
@@ -249,20 +294,296 @@ void Backlights::rainbowPattern()
     uint16_t my_phase = (phase + digit * phase_per_digit) % max_phase;
     setPixelColor(digit, phaseToColor(my_phase));
   }
-  if (dimming)
+  applyIntensity();
+  sendFrame();
+}
+
+void Backlights::selectEffect()
+{
+  if (config->pattern == chase)
+    effect.load(BacklightEffect::chase_program);
+  else if (config->pattern == comet)
+    effect.load(BacklightEffect::comet_program);
+  else if (config->pattern == seconds)
+    effect.load(BacklightEffect::seconds_program);
+  else
   {
-#if BACKLIGHT_DIMMED_INTENSITY > 0
-    setBrightness(0xFF >> max_intensity - (uint8_t)BACKLIGHT_DIMMED_INTENSITY - 1);
-#else // turn off backlight if intensity is 0
-    setBrightness(0);
-#endif
+    if (!custom_effect_read)
+    {
+      custom_effect_read = true;
+      fs::File f = LittleFS.open(BACKLIGHT_EFFECT_FILE, "r");
+      if (f)
+      {
+        String hex = f.readStringUntil('\n');
+        f.close();
+        if (!custom_effect.load(hex.c_str()))
+          Serial.println("Backlights: " BACKLIGHT_EFFECT_FILE " is not a valid effect.");
+      }
+    }
+    effect = custom_effect; // not loaded: the LEDs stay dark
+  }
+  effect_budget_warned = false;
+}
+
+bool Backlights::setCustomEffect(const char *hex)
+{
+  BacklightEffect new_effect;
+  if (!new_effect.load(hex))
+  {
+    Serial.printf("Backlights: invalid effect \"%s\"\n", hex);
+    return false;
+  }
+  custom_effect = new_effect;
+  custom_effect_read = true;
+  fs::File f = LittleFS.open(BACKLIGHT_EFFECT_FILE, "w");
+  if (f)
+  {
+    f.println(hex);
+    f.close();
   }
   else
+    Serial.println("Backlights: can't save the effect to " BACKLIGHT_EFFECT_FILE);
+  if (config->pattern == custom)
+    pattern_needs_init = true;
+  return true;
+}
+
+// Scales the colour by level (0..65535).
+static uint32_t scaleColor(uint32_t color, uint16_t level)
+{
+  uint32_t scale = uint32_t(level) + 1;
+  return ((color >> 16 & 0xFF) * scale >> 16) << 16 | ((color >> 8 & 0xFF) * scale >> 16) << 8 | ((color & 0xFF) * scale >> 16);
+}
+
+void Backlights::effectPattern()
+{
+  if (pattern_needs_init)
+    selectEffect();
+
+  applyIntensity();
+
+  if (!effect.isLoaded())
   {
-    setBrightness(0xFF >> max_intensity - config->intensity - 1);
+    clear();
+    sendFrame();
+    return;
   }
+
+  uint32_t start = micros();
+  uint16_t time = wave.advance(start, effect.getPeriodMs() * 1000) >> 16;
+  // Position of the second hand: seconds and milliseconds of the minute.
+  uint32_t ms_of_minute = millis() % 60000;
+  if (clock != nullptr)
+    ms_of_minute = clock->getSecond() * 1000UL + min<uint32_t>(999, 1000 - clock->getMillisToNextSecond());
+  uint16_t second = (ms_of_minute << 16) / 60000;
+
+  uint32_t color = phaseToColor(config->color_phase);
+  for (uint8_t led = 0; led < NUM_BACKLIGHT_LEDS; led++)
+  {
+    BacklightEffect::Pixel pixel = effect.eval(led, NUM_BACKLIGHT_LEDS, time, second);
+    uint32_t led_color = pixel.hue < 0 ? color : phaseToColor((pixel.hue * max_phase) >> 16);
+    setPixelColor(led, scaleColor(led_color, pixel.level));
+  }
+
+  effect_frame_us = micros() - start;
+  if (effect_frame_us > BACKLIGHT_EFFECT_BUDGET_US && !effect_budget_warned)
+  {
+    effect_budget_warned = true;
+    Serial.printf("Backlights: effect frame took %lu us, budget %u us.\n", (unsigned long)effect_frame_us, BACKLIGHT_EFFECT_BUDGET_US);
+  }
+  sendFrame();
+}
+
+// Makes the 16 bit frame of the pixels and gives it to the output, unless it is the same as the last one.
+// Dim frames are dithered by the refresh timer, the others are sent from here, at the frame rate of the pattern.
+void Backlights::sendFrame()
+{
+  const uint8_t *p = getPixels();
+  uint16_t frame[NUM_BACKLIGHT_LEDS * 3];
+  for (uint16_t i = 0; i < NUM_BACKLIGHT_LEDS * 3; i++)
+  {
+#ifdef BACKLIGHT_GAMMA_CORRECTION
+    frame[i] = (uint32_t(Waveform::gamma16(p[i])) * level) >> 8;
+#else
+    frame[i] = (uint32_t(p[i]) * 257 * level) >> 8;
+#endif
+  }
+  bool dither = level <= BACKLIGHT_DITHER_LEVEL;
+  uint32_t hash = hashBytes(frame, sizeof(frame));
+  if (hash == sent_hash && dither == sent_dither)
+  {
+    frames_skipped++;
+    return;
+  }
+  sent_hash = hash;
+  sent_dither = dither;
+  frames_sent++;
+
+  bool refresh_now = false;
+  OUTPUT_LOCK();
+  memcpy(next_frame, frame, sizeof(next_frame));
+  next_dither = dither;
+  frame_ready = true;
+  if (!timer_running)
+  {
+    if (dither && output_timer)
+      startRefreshTimer();
+    else
+      refresh_now = true;
+  }
+  OUTPUT_UNLOCK();
+  if (refresh_now)
+    refreshOutput();
+}
+
+// Sends the output frame to the LEDs, if there is a new one or it is dithered. If the RMT is still busy, at the next
+// refresh (timer or loop()).
+void Backlights::refreshOutput()
+{
+  if (!frame_ready && !dithering)
+    return;
+  if (!isOutputReady())
+    return;
+  if (frame_ready)
+  {
+    OUTPUT_LOCK();
+    memcpy(output_frame, next_frame, sizeof(output_frame));
+    output_dither = next_dither;
+    frame_ready = false;
+    OUTPUT_UNLOCK();
+  }
+
+  // Dim frames are dithered: the fraction is carried to the next refresh, so on average the LED gets the exact
+  // value. In brighter ones, one step of 8 bits doesn't show, they are rounded.
+  uint8_t frame[NUM_BACKLIGHT_LEDS * 3];
+  dithering = false;
+  for (uint16_t i = 0; i < NUM_BACKLIGHT_LEDS * 3; i++)
+  {
+    uint16_t value = output_frame[i];
+    if (!output_dither)
+    {
+      frame[i] = value >= 0xFF80 ? 255 : (value + 0x80) >> 8;
+    }
+    else
+    {
+      uint32_t dithered = uint32_t(value) + dither_error[i];
+      frame[i] = dithered > 0xFFFF ? 255 : dithered >> 8;
+      dither_error[i] = uint8_t(dithered);
+      if (value & 0xFF)
+        dithering = true;
+    }
+  }
+
+  uint32_t hash = hashBytes(frame, sizeof(frame));
+  if (hash == output_hash)
+    return;
+  writeFrame(frame);
+  output_hash = hash;
+  sent_us = micros();
+  refreshes++;
+}
+
+// FNV-1a. Never 0, which means "nothing sent".
+uint32_t Backlights::hashBytes(const void *data, uint16_t length)
+{
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  uint32_t hash = 2166136261u;
+  for (uint16_t i = 0; i < length; i++)
+    hash = (hash ^ p[i]) * 16777619u;
+  return hash != 0 ? hash : 1;
+}
+
+#ifndef NATIVE_BUILD
+void Backlights::beginOutput()
+{
+  rmt_config_t rmt = RMT_DEFAULT_CONFIG_TX((gpio_num_t)BACKLIGHTS_PIN, BACKLIGHTS_RMT_CHANNEL);
+  rmt.clk_div = 2;
+  rmt_output = rmt_config(&rmt) == ESP_OK && rmt_driver_install(rmt.channel, 0, 0) == ESP_OK;
+  if (!rmt_output)
+  {
+    Serial.println("Backlights: RMT not available, sending the LED data with show().");
+    return;
+  }
+
+  esp_timer_create_args_t timer_args = {};
+  timer_args.callback = &Backlights::refreshCallback;
+  timer_args.arg = this;
+  timer_args.name = "backlights";
+  output_timer = esp_timer_create(&timer_args, &refresh_timer) == ESP_OK;
+  if (!output_timer)
+    Serial.println("Backlights: no refresh timer, dithering from loop().");
+}
+
+// The timer runs only while a frame is dithered. Started by sendFrame(), it stops itself when nothing is left to do.
+// Both with the output lock held, so a frame can't be handed over while the timer stops.
+void Backlights::startRefreshTimer()
+{
+  timer_running = esp_timer_start_periodic(refresh_timer, 1000000 / BACKLIGHT_REFRESH_HZ) == ESP_OK;
+}
+
+void Backlights::refreshCallback(void *arg)
+{
+  Backlights *self = static_cast<Backlights *>(arg);
+  self->refreshOutput();
+  OUTPUT_LOCK();
+  if (!self->frame_ready && !self->dithering)
+  {
+    esp_timer_stop(self->refresh_timer);
+    self->timer_running = false;
+  }
+  OUTPUT_UNLOCK();
+}
+
+bool Backlights::isOutputReady()
+{
+  if (!rmt_output)
+    return true; // show() waits itself
+  if (rmt_wait_tx_done(BACKLIGHTS_RMT_CHANNEL, 0) != ESP_OK)
+    return false;
+  return micros() - sent_us >= NUM_BACKLIGHT_LEDS * 30 + WS2812_LATCH_US;
+}
+
+// The frame is in the order of the wire (GRB), most significant bit first.
+void Backlights::writeFrame(const uint8_t *frame)
+{
+  if (!rmt_output)
+  {
+    showFrame(frame);
+    return;
+  }
+  rmt_item32_t *item = rmt_items;
+  for (uint16_t i = 0; i < NUM_BACKLIGHT_LEDS * 3; i++)
+  {
+    for (uint8_t bit = 0x80; bit != 0; bit >>= 1, item++)
+    {
+      bool one = frame[i] & bit;
+      item->level0 = 1;
+      item->duration0 = one ? WS2812_T1H : WS2812_T0H;
+      item->level1 = 0;
+      item->duration1 = one ? WS2812_T1L : WS2812_T0L;
+    }
+  }
+  rmt_write_items(BACKLIGHTS_RMT_CHANNEL, rmt_items, NUM_BACKLIGHT_LEDS * 24, false);
+}
+#else
+// Host build: no timer, refreshOutput() runs from loop(). The NeoPixel shim doesn't block, it counts the frames and
+// their time on the wire.
+void Backlights::beginOutput() {}
+void Backlights::startRefreshTimer() {}
+void Backlights::refreshCallback(void *arg) {}
+bool Backlights::isOutputReady() { return true; }
+void Backlights::writeFrame(const uint8_t *frame) { showFrame(frame); }
+#endif // NATIVE_BUILD
+
+// Sends the frame with show(), which sends the pixels. They keep the colours of the pattern.
+void Backlights::showFrame(const uint8_t *frame)
+{
+  uint8_t colors[NUM_BACKLIGHT_LEDS * 3];
+  memcpy(colors, getPixels(), sizeof(colors));
+  memcpy(getPixels(), frame, sizeof(colors));
   show();
+  memcpy(getPixels(), colors, sizeof(colors));
 }
 
 const String Backlights::patterns_str[Backlights::num_patterns] =
-    {"Dark", "Test", "Constant", "Rainbow", "Pulse", "Breath"};
+    {"Dark", "Test", "Constant", "Rainbow", "Pulse", "Breath", "Chase", "Comet", "Seconds", "Custom"};
@@ -63,6 +63,7 @@ void ChipSelect::clear(bool update_)
   setDigitMap(all_off, update_);
 #else
   disableAllCSPins();
+  digits_map = all_off;
 #endif
 }
 
@@ -72,6 +73,7 @@ void ChipSelect::setAll(bool update_)
   setDigitMap(all_on, update_);
 #else
   enableAllCSPins();
+  digits_map = all_on;
 #endif
 }
 
@@ -99,8 +101,14 @@ void ChipSelect::setDigit(uint8_t digit, bool update_)
 #else
   // Set the actual currentLCD value for the given digit and activate the corresponding LCD
 
-  // first deactivate the current LCD
+  // first deactivate the current LCD, and the others selected by setDigits()
   disableDigitCSPins(currentLCD);
+  for (int i = 0; i < numLCDs; ++i)
+  {
+    if (digits_map & (1 << i))
+      disableDigitCSPins(i);
+  }
+  digits_map = 1 << digit;
   // store the current
   currentLCD = digit;
   // activate the new one
@@ -109,6 +117,27 @@ void ChipSelect::setDigit(uint8_t digit, bool update_)
 #endif
 }
 
+void ChipSelect::setDigits(uint8_t map)
+{
+#if (!defined(HARDWARE_IPSTUBE_CLOCK) && !defined(HARDWARE_MARVELTUBES_CLOCK))
+  setDigitMap(map);
+#else
+  for (int i = 0; i < numLCDs; ++i)
+  {
+    if (map & (1 << i))
+      enableDigitCSPins(i);
+    else
+      disableDigitCSPins(i);
+  }
+  digits_map = map;
+  for (int i = numLCDs - 1; i >= 0; --i)
+  {
+    if (map & (1 << i))
+      currentLCD = i; // the lowest one, kept active by update()
+  }
+#endif
+}
+
 void ChipSelect::update()
 {
 #if (!defined(HARDWARE_IPSTUBE_CLOCK) && !defined(HARDWARE_MARVELTUBES_CLOCK))
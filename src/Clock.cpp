@@ -245,6 +245,7 @@ void RtcSet(uint32_t tt)
 
 // Global variables for clock/NTP client
 uint32_t Clock::millis_last_ntp = 0;
+bool Clock::ntp_synced = false;
 WiFiUDP Clock::ntpUDP;
 NTPClient Clock::ntpTimeClient(ntpUDP, NTP_SERVER, 0, NTP_UPDATE_INTERVAL);
 
@@ -253,9 +254,10 @@ uint32_t Clock::current_ntp_interval_ms = Clock::ntp_interval_initial_ms;
 uint8_t Clock::consecutive_failures = 0;
 uint8_t Clock::consecutive_successes = 0;
 
-void Clock::begin(StoredConfig::Config::Clock *config_)
+void Clock::begin(StoredConfig::Config::Clock *config_, StoredConfig::Config::Rtc *rtc_config_)
 {
   config = config_;
+  rtc_config = rtc_config_;
 
   if (config->is_valid != StoredConfig::valid)
   {
@@ -268,6 +270,15 @@ void Clock::begin(StoredConfig::Config::Clock *config_)
     setActiveGraphicIdx(1);
     config->is_valid = StoredConfig::valid;
   }
+  if (rtc_config->is_valid != StoredConfig::valid)
+  { // The RTC was not set to NTP yet, or by an older firmware: its drift is learned from the first NTP sync on.
+    memset(rtc_config, 0, sizeof(*rtc_config));
+  }
+  else
+  {
+    Serial.printf("RTC drift %+.3f ppm, learned from %u NTP syncs.\n", rtc_config->drift_ppb / 1000.0,
+                  rtc_config->drift_syncs);
+  }
 
   RtcBegin();            // Initialize the RTC chip
   ntpTimeClient.begin(); // Initialize the NTP client
@@ -279,7 +290,7 @@ void Clock::begin(StoredConfig::Config::Clock *config_)
   setSyncProvider(&Clock::syncProvider);
 
   // Set TimeLib sync interval to current adaptive interval
-  setSyncInterval(current_ntp_interval_ms / 1000); // This will make TimeLib call syncProvider() adaptively.
+  setSyncInterval(min(current_ntp_interval_ms, rtc_read_interval_ms) / 1000); // TimeLib calls syncProvider() adaptively.
 
 #ifdef DEBUG_NTPClient
   Serial.print("DEBUG_NTPClient: Initial NTP sync interval set to ");
@@ -292,13 +303,36 @@ void Clock::begin(StoredConfig::Config::Clock *config_)
 
 void Clock::loop()
 {
+  pollNtp();
+  pollRtcEdge();
   if (timeStatus() == timeNotSet)
   {
     time_valid = false;
   }
   else
   {
+    time_t previous_time = loop_time;
     loop_time = now();
+    if (model_valid)
+    { // The second from the NTP model, it begins on the millisecond
+      uint32_t elapsed = millis() - model_millis;
+      model_second += elapsed / 1000;
+      model_millis += (elapsed / 1000) * 1000;
+      if (loop_time > model_second + 1 || loop_time + 1 < model_second)
+      { // TimeLib was synced to the RTC meanwhile and the model drifted away, e.g. after many hours without NTP
+        Serial.println("NTP time model differs from the RTC, using the RTC time.");
+        model_valid = false;
+      }
+    }
+    if (model_valid)
+    {
+      loop_time = model_second;
+      millis_at_second = model_millis;
+      if (loop_time != previous_time && (align_pending || rtc_set_pending))
+        alignToSecond();
+    }
+    else if (loop_time != previous_time)
+      millis_at_second = millis();
     local_time = loop_time + config->time_zone_offset;
     time_valid = true;
   }
@@ -329,65 +363,305 @@ time_t Clock::syncProvider()
   // check if we need to update from the NTP time
   if (millis() - millis_last_ntp >= current_ntp_interval_ms || millis_last_ntp == 0) // Adaptive interval timing
   {                                                                                  // It's time to get a new NTP sync
+    if (ntpTimeClient.isUpdatePending())
+    { // The answer to the last request is still awaited, see pollNtp().
+      return getRtcTime();
+    }
     Serial.println("\nTime to update from NTP Server...");
     if (WifiState == connected)
-    { // We have WiFi, so try to get NTP time.
-      if (ntpTimeClient.update())
+    { // We have WiFi, so ask for the NTP time. The answer is applied by pollNtp(), when it arrives.
+      millis_last_ntp = millis(); // Store the last time we tried to get NTP time
+      if (ntpTimeClient.beginUpdate())
       {
-        Serial.println("NTP update query was successful!");
-        time_t ntp_now = ntpTimeClient.getEpochTime();
-        Serial.print("NTP time = ");
-        Serial.println(ntpTimeClient.getFormattedTime());
-        rtc_now = RtcGet(); // Get the RTC time again, because it may have changed in the meantime
-        // Sync the RTC to NTP if needed.
-        Serial.print("NTP: ");
-        Serial.println(ntp_now);
-        Serial.print("RTC: ");
-        Serial.println(rtc_now);
-        Serial.print("Diff: ");
-        Serial.println(ntp_now - rtc_now);
-
-        if ((ntp_now != rtc_now) && (ntp_now > 1761609600)) // check if we have a difference and a valid NTP time (check for after 1761609600 = 2025-10-28 00:00:01 UTC)
-        {                                                   // NTP time is valid and different from RTC time
-          Serial.println("RTC and NTP time differs more than 1 second, updating RTC time.");
-          RtcSet(ntp_now);
-          Serial.println("RTC is now set to NTP time.");
-          rtc_now = RtcGet(); // Check if RTC time is set correctly
-          Serial.print("RTC time = ");
-          Serial.println(rtc_now);
-        }
-        else if ((ntp_now != rtc_now) && (ntp_now < 1743364444))
-        { // NTP can't be valid!
-          Serial.println("Time returned from NTP is not valid! Using RTC time!");
-          rtc_now = RtcGet(); // Get the RTC time again, because it may have changed in the meantime
-          return rtc_now;
-        }
-        millis_last_ntp = millis(); // Store the last time we tried to get NTP time
-        handleNtpSuccess();         // Update adaptive timing
-
-        Serial.println("Using NTP time!");
-        return ntp_now;
+        Serial.println("NTP request sent, using RTC time until the answer arrives.");
       }
       else
-      { // NTP return value is not valid
-        Serial.println("NTP update query was not successful!\nUsing RTC time!");
-        millis_last_ntp = millis(); // store the last attempt time even on failure
-        handleNtpFailure();         // Update adaptive timing
-        rtc_now = RtcGet();         // Get the RTC time
-        return rtc_now;
+      {
+        Serial.println("NTP request could not be sent!\nUsing RTC time!");
+        handleNtpFailure(); // Update adaptive timing
       }
+      rtc_now = getRtcTime();
+      return rtc_now;
     } // no WiFi!
     Serial.println("No WiFi!\nUsing RTC time!");
     millis_last_ntp = millis(); // store the last attempt time even on WiFi failure
     handleNtpFailure();         // Update adaptive timing for WiFi failures too
-    rtc_now = RtcGet();         // Get the RTC time (if update interval not reached or no WiFi or NTP failure)
+    rtc_now = getRtcTime();     // Get the RTC time (if update interval not reached or no WiFi or NTP failure)
     return rtc_now;
   }
   Serial.println("Using RTC time.");
-  rtc_now = RtcGet(); // read RTC time if no NTP update is needed
+  rtc_now = getRtcTime(); // read RTC time if no NTP update is needed
   return rtc_now;
 }
 
+// Variables of the millisecond model, see pollNtp()
+bool Clock::model_valid = false;
+time_t Clock::model_second = 0;
+uint32_t Clock::model_millis = 0;
+bool Clock::align_pending = false;
+bool Clock::rtc_set_pending = false;
+
+// Picks up the answer to the NTP request sent by syncProvider(), without waiting for it. Called from loop().
+void Clock::pollNtp()
+{
+  if (!ntpTimeClient.isUpdatePending())
+    return;
+  NTPClient::UpdateState state = ntpTimeClient.pollUpdate();
+  if (state == NTPClient::UPDATE_PENDING)
+    return;
+  if (state == NTPClient::UPDATE_FAILED)
+  { // No or no valid answer
+    Serial.println("NTP update query was not successful!\nKeeping RTC time!");
+    millis_last_ntp = millis(); // store the last attempt time even on failure
+    handleNtpFailure();         // Update adaptive timing
+    return;
+  }
+
+  Serial.println("NTP update query was successful!");
+  uint32_t at_millis = millis();
+  uint64_t ntp_millis = ntpTimeClient.getEpochMillis(at_millis);
+  time_t ntp_now = ntp_millis / 1000;
+  Serial.print("NTP time = ");
+  Serial.print(ntpTimeClient.getFormattedTime());
+  Serial.printf(".%03u, round trip %lu ms\n", unsigned(ntp_millis % 1000), ntpTimeClient.getRoundTripMs());
+  time_t rtc_raw = RtcGet(); // Get the RTC time again, because it may have changed in the meantime
+  time_t rtc_now = correctRtcTime(rtc_raw);
+  // Sync the RTC to NTP if needed.
+  Serial.print("NTP: ");
+  Serial.println(ntp_now);
+  Serial.print("RTC: ");
+  Serial.print(rtc_now);
+  Serial.print(" (read ");
+  Serial.print(rtc_raw);
+  Serial.println(")");
+  Serial.print("Diff: ");
+  Serial.println(ntp_now - rtc_now);
+
+  rtc_set_pending = false;
+  rtc_edge_pending = false;
+  bool measure_drift = false;
+  if (ntp_now > 1761609600) // check for a valid NTP time (after 1761609600 = 2025-10-28 00:00:01 UTC)
+  {
+    // The RTC can be off by its drift since it was set, plus a second for the reading.
+    int32_t set_ago = ntp_now - time_t(rtc_config->set_time);
+    if (rtc_config->is_valid == StoredConfig::valid && set_ago >= 0 &&
+        abs(int32_t(ntp_now - rtc_raw)) <= 2 + int64_t(set_ago) * rtc_drift_max_ppb / 1000000000)
+    { // See measureRtcDrift(), it sets the RTC again if needed.
+      measure_drift = true;
+    }
+    else
+    {
+      if (rtc_config->is_valid != StoredConfig::valid)
+        Serial.println("RTC was not set to NTP time yet, updating RTC time at the next second.");
+      else
+        Serial.println("RTC and NTP time differ more than the RTC drift, updating RTC time at the next second.");
+      rtc_set_pending = true; // see alignToSecond()
+    }
+  }
+  else if ((ntp_now != rtc_now) && (ntp_now < 1743364444))
+  { // NTP can't be valid!
+    Serial.println("Time returned from NTP is not valid! Keeping RTC time!");
+    return;
+  }
+  millis_last_ntp = millis(); // Store the last time we tried to get NTP time
+  ntp_synced = true;
+  handleNtpSuccess(); // Update adaptive timing (and the TimeLib sync interval) first...
+  setTime(ntp_now);   // ...then TimeLib takes the NTP time, the next sync follows after the interval
+
+  // From now on loop() counts the seconds from the millisecond the NTP second began.
+  model_second = ntp_now;
+  model_millis = at_millis - uint32_t(ntp_millis % 1000);
+  model_valid = true;
+  align_pending = true;
+  if (measure_drift)
+    startRtcEdge(rtc_raw, true); // after the model is set, it tells when the RTC's next second is due
+
+  Serial.println("Using NTP time!");
+}
+
+// Called by loop() in the first loop of a new second of the NTP model: TimeLib's seconds (and the RTC's, if it is set)
+// then begin within a few ms of the real second.
+void Clock::alignToSecond()
+{
+  if (align_pending)
+  {
+    align_pending = false;
+    setTime(model_second);
+  }
+  if (rtc_set_pending)
+  { // Writing the seconds restarts the RTC's second, so its seconds begin with the NTP seconds from here.
+    rtc_set_pending = false;
+    RtcSet(model_second);
+    rtc_config->set_time = model_second;
+    rtc_config->is_valid = StoredConfig::valid;
+    config_save_pending = true;
+    Serial.print("RTC is now set to NTP time: ");
+    Serial.println(RtcGet());
+  }
+}
+
+// Variables of the RTC drift measurement
+StoredConfig::Config::Rtc *Clock::rtc_config = NULL;
+bool Clock::rtc_drift_calibrated = false;
+bool Clock::config_save_pending = false;
+bool Clock::rtc_edge_pending = false;
+bool Clock::rtc_edge_for_drift = false;
+time_t Clock::rtc_edge_value = 0;
+uint32_t Clock::rtc_edge_start = 0;
+uint32_t Clock::rtc_edge_last_read = 0;
+uint32_t Clock::rtc_edge_expected = 0;
+uint32_t Clock::rtc_edge_wake = 0;
+
+// The RTC time for TimeLib. Without an NTP request on the way, the model then follows the RTC's seconds.
+time_t Clock::getRtcTime()
+{
+  time_t rtc_now = RtcGet();
+  if (!ntpTimeClient.isUpdatePending())
+    startRtcEdge(rtc_now, false);
+  return correctRtcTime(rtc_now);
+}
+
+// How many ms the RTC gained (or lost, < 0) by its drift since it was set to NTP. 0 when the drift is not known yet.
+int32_t Clock::getRtcGainedMs(time_t rtc_time)
+{
+  if (rtc_config == NULL || rtc_config->is_valid != StoredConfig::valid || rtc_config->drift_syncs == 0 ||
+      rtc_time <= time_t(rtc_config->set_time))
+    return 0;
+  return int64_t(rtc_time - time_t(rtc_config->set_time)) * rtc_config->drift_ppb / 1000000;
+}
+
+time_t Clock::correctRtcTime(time_t rtc_time)
+{
+  int32_t gained_ms = getRtcGainedMs(rtc_time);
+  return rtc_time - (gained_ms + (gained_ms < 0 ? -500 : 500)) / 1000;
+}
+
+// With a valid model, the RTC's next second is expected when the model says so (the RTC was set on the NTP second, plus
+// its learned drift). The RTC is then read again only from rtc_edge_early_ms before that, not every ms for a second.
+void Clock::startRtcEdge(time_t rtc_time, bool for_drift)
+{
+  rtc_edge_pending = true;
+  rtc_edge_for_drift = for_drift;
+  rtc_edge_value = rtc_time;
+  rtc_edge_start = rtc_edge_last_read = rtc_edge_wake = millis();
+  if (!model_valid)
+    return;
+  time_t next_second = rtc_time + 1;
+  rtc_edge_expected = model_millis + uint32_t(int64_t(next_second - model_second) * 1000 - getRtcGainedMs(next_second));
+  int32_t ms_to_edge = rtc_edge_expected - rtc_edge_start;
+  if (ms_to_edge > int32_t(rtc_edge_early_ms) && ms_to_edge <= int32_t(1000 + rtc_edge_early_ms))
+    rtc_edge_wake = rtc_edge_expected - rtc_edge_early_ms;
+}
+
+// Reads the RTC until its second changes. The RTC only counts whole seconds, the moment it does is its fraction.
+void Clock::pollRtcEdge()
+{
+  if (!rtc_edge_pending || int32_t(millis() - rtc_edge_wake) < 0)
+    return;
+  time_t rtc_now = RtcGet();
+  uint32_t read_at = millis();
+  if (rtc_now != rtc_edge_value + 1 || read_at - rtc_edge_last_read > rtc_edge_max_gap_ms)
+  { // Not yet, or the last read was too long ago to tell when it happened
+    if (read_at - rtc_edge_start > rtc_edge_timeout_ms)
+    {
+      rtc_edge_pending = false;
+      Serial.println("RTC second doesn't change!");
+      if (rtc_edge_for_drift)
+        rtc_set_pending = true; // see alignToSecond()
+      return;
+    }
+    rtc_edge_expected += int32_t(rtc_now - rtc_edge_value) * 1000; // the expected second went by unseen
+    rtc_edge_value = rtc_now;
+    rtc_edge_last_read = read_at;
+    return;
+  }
+  rtc_edge_pending = false;
+  uint32_t edge_millis = rtc_edge_last_read + (read_at - rtc_edge_last_read) / 2; // between the last two reads
+  if (rtc_edge_for_drift)
+    measureRtcDrift(rtc_now, edge_millis);
+  else if (!model_valid || abs(int32_t(edge_millis - rtc_edge_expected)) > int32_t(rtc_anchor_max_ms))
+    anchorToRtc(rtc_now, edge_millis);
+  // else the model agrees with the RTC, it keeps running
+}
+
+// After an NTP sync: compares the RTC's second with the NTP second and learns the drift from the difference.
+void Clock::measureRtcDrift(time_t rtc_second, uint32_t edge_millis)
+{
+  if (!model_valid)
+    return;
+  int64_t ntp_ms = int64_t(model_second) * 1000 + int32_t(edge_millis - model_millis); // NTP time at the RTC's second
+  int32_t offset_ms = int64_t(rtc_second) * 1000 - ntp_ms;                              // > 0: the RTC is ahead
+  int32_t residual_ms = offset_ms - getRtcGainedMs(rtc_second);
+  int32_t elapsed_s = ntp_ms / 1000 - time_t(rtc_config->set_time);
+  Serial.printf("RTC is %+ld ms off NTP (%+ld ms with the drift correction), %ld s after it was set.\n", long(offset_ms),
+                long(residual_ms), long(elapsed_s));
+
+  if (elapsed_s >= rtc_drift_min_baseline_s)
+  {
+    int32_t measured_ppb = int64_t(offset_ms) * 1000000 / elapsed_s;
+    if (abs(measured_ppb) > rtc_drift_max_ppb)
+    { // Somebody else set the RTC, or it lost its time
+      Serial.println("RTC drift is not plausible, updating RTC time at the next second.");
+      rtc_set_pending = true;
+      return;
+    }
+    rtc_drift_calibrated = rtc_config->drift_syncs > 0 && abs(residual_ms) <= rtc_residual_max_ms;
+    if (rtc_config->drift_syncs == 0)
+      rtc_config->drift_ppb = measured_ppb;
+    else
+      rtc_config->drift_ppb += (measured_ppb - rtc_config->drift_ppb) / 4; // average, the drift changes with the temperature
+    if (rtc_config->drift_syncs < 255)
+      rtc_config->drift_syncs++;
+    Serial.printf("RTC drift %+.3f ppm (measured %+.3f ppm), learned from %u NTP syncs.\n", rtc_config->drift_ppb / 1000.0,
+                  measured_ppb / 1000.0, rtc_config->drift_syncs);
+    updateNtpInterval();
+  }
+
+  if (abs(offset_ms) >= rtc_offset_max_ms)
+  {
+    Serial.println("RTC and NTP time differ, updating RTC time at the next second.");
+    rtc_set_pending = true; // see alignToSecond(), the config is saved after that
+  }
+  else if (elapsed_s >= rtc_drift_min_baseline_s)
+    config_save_pending = true;
+}
+
+// Without NTP: the model takes the RTC's seconds, less the learned drift. Its seconds began with the NTP seconds when
+// it was set, so the digits keep changing on the second.
+void Clock::anchorToRtc(time_t rtc_second, uint32_t edge_millis)
+{
+  int64_t rtc_ms = int64_t(rtc_second) * 1000 - getRtcGainedMs(rtc_second);
+  model_second = rtc_ms / 1000;
+  model_millis = edge_millis - uint32_t(rtc_ms % 1000);
+  model_valid = true;
+  align_pending = true;
+}
+
+void Clock::idle(uint32_t ms)
+{
+  uint32_t start = millis();
+  for (uint32_t elapsed = 0; elapsed < ms; elapsed = millis() - start)
+  {
+    int32_t ms_to_wake = rtc_edge_wake - millis();
+    if (ntpTimeClient.isUpdatePending() || (rtc_edge_pending && ms_to_wake <= 0))
+    { // Look for the NTP answer and the RTC's second every ms, their times are measured
+      delay(1);
+      pollNtp();
+      pollRtcEdge();
+    }
+    else if (rtc_edge_pending) // the RTC's second is not due yet
+      delay(min(ms - elapsed, uint32_t(ms_to_wake)));
+    else
+      delay(ms - elapsed);
+  }
+}
+
+void Clock::requestNtpSync()
+{
+  millis_last_ntp = 0;                   // NTP is due...
+  setSyncProvider(&Clock::syncProvider); // ...and TimeLib calls syncProvider(), which sends the request
+}
+
 uint8_t Clock::getHoursTens()
 {
   uint8_t hour_tens = getHour() / 10;
@@ -402,6 +676,26 @@ uint8_t Clock::getHoursTens()
   }
 }
 
+void Clock::getNextSecondDigits(uint8_t next_digits[NUM_DIGITS])
+{
+  time_t next_time = local_time + 1;
+  uint8_t next_hour = config->twelve_hour ? hourFormat12(next_time) : hour(next_time);
+  next_digits[SECONDS_ONES] = second(next_time) % 10;
+  next_digits[SECONDS_TENS] = second(next_time) / 10;
+  next_digits[MINUTES_ONES] = minute(next_time) % 10;
+  next_digits[MINUTES_TENS] = minute(next_time) / 10;
+  next_digits[HOURS_ONES] = next_hour % 10;
+  next_digits[HOURS_TENS] = (config->blank_hours_zero && next_hour / 10 == 0) ? TFTs::blanked : next_hour / 10;
+}
+
+uint32_t Clock::getMillisToNextSecond()
+{
+  if (!time_valid)
+    return 1000; // no second to wait for, loop() isn't following the time
+  uint32_t elapsed = millis() - millis_at_second;
+  return elapsed < 1000 ? 1000 - elapsed : 0;
+}
+
 // Adaptive NTP sync methods
 void Clock::handleNtpSuccess()
 {
@@ -440,6 +734,8 @@ void Clock::updateNtpInterval()
     else if (consecutive_failures >= 3)
       current_ntp_interval_ms = min(ntp_interval_error_ms * (1 << (consecutive_failures - 1)), ntp_interval_max_ms); // After 3+ failures: double the interval up to maximum
   }
+  else if (consecutive_successes >= 9 && rtc_drift_calibrated)
+    current_ntp_interval_ms = ntp_interval_calibrated_ms; // After 9+ successes with the RTC drift known: 6 hours
   else if (consecutive_successes >= 6)
     current_ntp_interval_ms = ntp_interval_stable_ms; // After 6+ successes: move to stable interval (1 hour)
   else if (consecutive_successes >= 3)
@@ -447,9 +743,9 @@ void Clock::updateNtpInterval()
   else
     current_ntp_interval_ms = ntp_interval_initial_ms; // Initial or few successes: keep initial interval (5 min)
 
-  // Update TimeLib sync interval if it changed
+  // Update TimeLib sync interval if it changed. Between the NTP syncs TimeLib takes the RTC time.
   if (old_interval != current_ntp_interval_ms)
-    setSyncInterval(current_ntp_interval_ms / 1000);
+    setSyncInterval(min(current_ntp_interval_ms, rtc_read_interval_ms) / 1000);
 
 #ifdef DEBUG_NTPClient
   if (old_interval != current_ntp_interval_ms)
@@ -0,0 +1,109 @@
+#include "LoopProfiler.h"
+#include <algorithm>
+
+const char *LoopProfiler::stage_str[LoopProfiler::num_stages] = {"wifi", "mqtt", "buttons", "menu", "backlights", "clock", "display", "load_image", "free_time", "total"};
+const char *LoopProfiler::boot_phase_str[LoopProfiler::num_boot_phases] = {"config", "peripherals", "displays", "wifi", "clock", "mqtt", "geoloc", "first_digits", "ntp"};
+
+void LoopProfiler::bootPhaseDone(boot_phase_t phase)
+{
+  boot_done[phase] = millis();
+  if (boot_done[phase] == 0)
+    boot_done[phase] = 1; // 0 means not done
+  if (boot_start[phase] == 0)
+    boot_start[phase] = boot_done[phase];
+  Serial.printf("Boot phase %s: %lu ms (done at %lu ms)\n", boot_phase_str[phase], (unsigned long)getBootPhaseMs(phase),
+                (unsigned long)boot_done[phase]);
+}
+
+void LoopProfiler::printBootReport(Print &out)
+{
+  out.printf("Boot phases, times in ms since power-on\n");
+  out.printf("%-13s %8s %8s\n", "phase", "start", "duration");
+  for (uint8_t phase = 0; phase < num_boot_phases; phase++)
+  {
+    if (boot_start[phase] == 0)
+      continue; // not used in this build
+    if (boot_done[phase] == 0)
+      out.printf("%-13s %8lu  running\n", boot_phase_str[phase], (unsigned long)boot_start[phase]);
+    else
+      out.printf("%-13s %8lu %8lu\n", boot_phase_str[phase], (unsigned long)boot_start[phase],
+                 (unsigned long)getBootPhaseMs(boot_phase_t(phase)));
+  }
+}
+
+#ifdef LOOP_PROFILER
+void LoopProfiler::record(stage_t stage, uint32_t us)
+{
+  if (window_start == 0)
+    resetWindow();
+  samples[stage][next[stage]] = encode(us);
+  next[stage] = (next[stage] + 1) % LOOP_PROFILER_SAMPLES;
+  if (count[stage] < LOOP_PROFILER_SAMPLES)
+    count[stage]++;
+  if (us < window_min[stage])
+    window_min[stage] = us;
+  if (us > window_max[stage])
+    window_max[stage] = us;
+  if (stage == total)
+    loops++;
+}
+
+LoopProfiler::Stats LoopProfiler::getStats(stage_t stage)
+{
+  Stats stats = {0, 0, 0, 0, count[stage]};
+  if (count[stage] == 0)
+    return stats;
+
+  // Percentiles of the ring buffer, on a copy: the order of the samples doesn't matter, only their values.
+  uint16_t sorted[LOOP_PROFILER_SAMPLES];
+  memcpy(sorted, samples[stage], count[stage] * sizeof(sorted[0]));
+  uint16_t *end = sorted + count[stage];
+  uint16_t *p50 = sorted + (count[stage] - 1) / 2;
+  uint16_t *p99 = sorted + (count[stage] - 1) * 99 / 100;
+  std::nth_element(sorted, p99, end);
+  std::nth_element(sorted, p50, p99);
+  stats.p50 = decode(*p50);
+  stats.p99 = decode(*p99);
+
+  // Min and max of the window, or of the ring buffer if nothing was measured since the last report.
+  if (window_max[stage] >= window_min[stage])
+  {
+    stats.min = window_min[stage];
+    stats.max = window_max[stage];
+  }
+  else
+  {
+    stats.min = decode(*std::min_element(sorted, end));
+    stats.max = decode(*std::max_element(sorted, end));
+  }
+  return stats;
+}
+
+void LoopProfiler::resetWindow()
+{
+  for (uint8_t stage = 0; stage < num_stages; stage++)
+  {
+    window_min[stage] = UINT32_MAX;
+    window_max[stage] = 0;
+  }
+  window_start = millis();
+  if (window_start == 0)
+    window_start = 1; // 0 means not started
+  loops = 0;
+}
+
+void LoopProfiler::printReport(Print &out)
+{
+  out.printf("Loop profile: %lu loops in the last %lu s, times in us (median and p99 of the last %u calls)\n",
+             (unsigned long)loops, (unsigned long)(getWindowMs() / 1000), LOOP_PROFILER_SAMPLES);
+  out.printf("%-11s %8s %8s %8s %8s\n", "stage", "min", "p50", "p99", "max");
+  for (uint8_t stage = 0; stage < num_stages; stage++)
+  {
+    Stats stats = getStats(stage_t(stage));
+    if (stats.samples == 0)
+      continue; // stage not used in this build
+    out.printf("%-11s %8lu %8lu %8lu %8lu\n", stage_str[stage], (unsigned long)stats.min, (unsigned long)stats.p50,
+               (unsigned long)stats.p99, (unsigned long)stats.max);
+  }
+}
+#endif // LOOP_PROFILER
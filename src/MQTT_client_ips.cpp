@@ -33,6 +33,7 @@
 #include <cctype>
 #include "Backlights.h"
 #include "Clock.h"
+#include "LoopProfiler.h"
 #include "TFTs.h"
 #ifdef MQTT_USE_TLS // For secure WiFi client
 #include <WiFiClientSecure.h>
@@ -56,6 +57,7 @@ void MQTTReportState(bool forceUpdateEverything);
 void MQTTReportBackOnChange();
 void MQTTReportBackEverything(bool forceUpdateEverything);
 void MQTTPeriodicReportBack();
+void MQTTReportDiagnostics();
 
 // Plain MQTT mode functions.
 void MQTTReportPowerState(bool forceUpdate);
@@ -81,6 +83,7 @@ bool loadCARootCert();
 char outbuf[64];
 
 uint32_t lastTimeSent = (uint32_t)(MQTT_REPORT_STATUS_EVERY_SEC * -1000);
+uint32_t lastTimeDiagnosticsSent = 0;
 uint32_t LastTimeTriedToConnect = 0;
 
 bool MQTTConnected = false;     // Show connection status on the clock's LCD
@@ -122,6 +125,8 @@ char MQTTCommandPattern[24] = "";
 bool MQTTCommandPatternReceived = false;
 char MQTTCommandBackPattern[24] = "";
 bool MQTTCommandBackPatternReceived = false;
+char MQTTCommandBackEffect[BacklightEffect::max_text] = ""; // program of the custom backlight effect, hex
+bool MQTTCommandBackEffectReceived = false;
 
 uint16_t MQTTCommandBackColorPhase = -1;
 bool MQTTCommandBackColorPhaseReceived = false;
@@ -616,6 +621,16 @@ void MQTTCallback(char *topic, byte *payload, unsigned int length)
       MQTTCommandBackPowerReceived = true;
     }
   }
+  else if (endsWith(topic, "/directive/backlightEffect"))
+  {
+    if (strlen(message) < sizeof(MQTTCommandBackEffect))
+    {
+      strcpy(MQTTCommandBackEffect, message);
+      MQTTCommandBackEffectReceived = true;
+    }
+    else
+      Serial.println("WARNING: Backlight effect program too long, ignored!");
+  }
   else if (endsWith(topic, "/directive/setpoint") || endsWith(topic, "/directive/percentage"))
   {
     double valueD = atof(message);
@@ -713,6 +728,17 @@ void MQTTCallback(char *topic, byte *payload, unsigned int length)
           MQTTCommandBackPattern[sizeof(MQTTCommandBackPattern) - 1] = '\0';
           MQTTCommandBackPatternReceived = true;
         }
+        if (doc["effect_program"].is<const char *>())
+        {
+          const char *program = doc["effect_program"];
+          if (strlen(program) < sizeof(MQTTCommandBackEffect))
+          {
+            strcpy(MQTTCommandBackEffect, program);
+            MQTTCommandBackEffectReceived = true;
+          }
+          else
+            Serial.println("WARNING: Backlight effect program too long, ignored!");
+        }
         if (doc["color"].is<JsonObject>())
         {
           MQTTCommandBackColorPhase = backlights.hueToPhase(doc["color"]["h"]);
@@ -838,6 +864,49 @@ void MQTTLoopInFreeTime()
 {
   MQTTReportBackOnChange();
   MQTTPeriodicReportBack();
+  MQTTReportDiagnostics();
+}
+
+// Sends the loop profile to <root>/<device>/diag: loops and window length, then min, p50, p99 and max in us for each stage.
+void MQTTReportDiagnostics()
+{
+#ifdef LOOP_PROFILER
+  if (((millis() - lastTimeDiagnosticsSent) < (LOOP_PROFILER_REPORT_SEC * 1000)) || !MQTTclient.connected())
+    return;
+  lastTimeDiagnosticsSent = millis();
+
+  JsonDocument diag;
+  diag["loops"] = loop_profiler.getLoops();
+  diag["window_ms"] = loop_profiler.getWindowMs();
+  for (uint8_t stage = 0; stage < LoopProfiler::num_stages; stage++)
+  {
+    LoopProfiler::Stats stats = loop_profiler.getStats(LoopProfiler::stage_t(stage));
+    if (stats.samples == 0)
+      continue;
+    JsonObject entry = diag[LoopProfiler::stage_str[stage]].to<JsonObject>();
+    entry["min"] = stats.min;
+    entry["p50"] = stats.p50;
+    entry["p99"] = stats.p99;
+    entry["max"] = stats.max;
+  }
+  JsonObject boot = diag["boot"].to<JsonObject>(); // duration of each finished phase of the start-up, in ms
+  for (uint8_t phase = 0; phase < LoopProfiler::num_boot_phases; phase++)
+  {
+    if (loop_profiler.isBootPhaseDone(LoopProfiler::boot_phase_t(phase)))
+      boot[LoopProfiler::boot_phase_str[phase]] = loop_profiler.getBootPhaseMs(LoopProfiler::boot_phase_t(phase));
+  }
+  JsonObject ntp = diag["ntp"].to<JsonObject>();
+  ntp["interval_s"] = Clock::getCurrentNtpInterval() / 1000;
+  ntp["rtc_drift_ppb"] = Clock::getRtcDriftPpb();
+  ntp["rtc_drift_syncs"] = Clock::getRtcDriftSyncs();
+  ntp["rtc_calibrated"] = Clock::isRtcDriftCalibrated();
+#ifdef MQTT_CLIENT_ID_FOR_SMARTNEST
+  MQTTPublish(concat7_into(outbuf, UniqueDeviceName, "/diag", "", "", "", "", ""), &diag, false);
+#else
+  MQTTPublish(concat7_into(outbuf, MQTT_ROOT_TOPIC, "/", UniqueDeviceName, "/diag", "", "", ""), &diag, false);
+#endif
+  loop_profiler.resetWindow();
+#endif // LOOP_PROFILER
 }
 
 #ifdef MQTT_PLAIN_ENABLED
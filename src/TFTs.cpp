@@ -1,6 +1,7 @@
 #include "MQTT_client_ips.h"
 #include "TFTs.h"
 #include "WiFi_WPS.h"
+#include <esp_heap_caps.h>
 
 void TFTs::begin()
 {
@@ -19,8 +20,17 @@ void TFTs::begin()
 #if defined(HARDWARE_MARVELTUBES_CLOCK)
   chip_select.reclaimPins(); // regain control of per-digit CS pins after TFT_eSPI::init()
   chip_select.setAll(); // After regain control, start with all displays selected again  
+#endif
+#ifdef TFT_USE_DMA
+  DMAEnabled = initDMA(); // CS lines are driven by ChipSelect, not by the DMA driver
+  Serial.println(DMAEnabled ? "TFT DMA enabled." : "TFT DMA not available, using blocking transfers.");
+#endif
+#ifndef TFT_BAND_ROWS
+  AllocateImageBuffers();
 #endif
   fillScreen(TFT_BLACK);     // to avoid/reduce flickering patterns on the screens
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+    SetDisplayBlack(digit);
 #if defined(HARDWARE_IPSTUBE_CLOCK) || defined(HARDWARE_MARVELTUBES_CLOCK)
   delay(100); // give some time to avoid glitches on power up
   ledcAttachPin(TFT_ENABLE_PIN, TFT_PWM_CHANNEL);                         // Attach the pin to the PWM channel -> this "enables" (backlight power on) the displays
@@ -37,12 +47,16 @@ void TFTs::begin()
 
   NumberOfClockFaces = CountNumberOfClockFaces();
   loadClockFacesNames();
+#ifdef GLYPH_CACHE
+  AllocateGlyphCache();
+#endif
 }
 
 void TFTs::reinit()
 {
   if (!TFTsEnabled) // perform re-init only if displays are actually off. HA sends ON command together with clock face change which causes flickering.
   {
+    WaitForImageTransfer();
 #ifndef TFT_SKIP_REINIT
     // Start with all displays selected.
     chip_select.begin();
@@ -61,6 +75,8 @@ void TFTs::reinit()
   chip_select.setAll(); // After regain control, start with all displays selected again
 #endif
     fillScreen(TFT_BLACK);     // to avoid/reduce flickering patterns on the screens
+    for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+      SetDisplayBlack(digit);
     enableAllDisplays();       // Signal, that the displays are enabled now
 #else                          // TFT_SKIP_REINIT
     enableAllDisplays(); // skip full inintialization, just reenable displays by signaling to enable them
@@ -71,14 +87,21 @@ void TFTs::reinit()
 void TFTs::clear()
 {
   // Start with all displays selected.
+  FinishTransitions();
+  WaitForImageTransfer();
   chip_select.setAll();
   enableAllDisplays();
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+    InvalidateDisplayRows(digit); // caller draws directly to the displays
 }
 
 void TFTs::loadClockFacesNames()
 {
   int8_t i = 0;
   const char *filename = "/clockfaces.txt";
+  for (i = 0; i < MAX_CLOCK_FACES; i++)
+    patterns_str[i] = String(i + 1); // default names
+  i = 0;
   Serial.println("Loading clock face names...");
   fs::File f = LittleFS.open(filename);
   if (!f)
@@ -86,7 +109,7 @@ void TFTs::loadClockFacesNames()
     Serial.println("ERROR: LittleFS clockfaces.txt not found.");
     return;
   }
-  while (f.available() && i < 9)
+  while (f.available() && i < MAX_CLOCK_FACES)
   {
     patterns_str[i] = f.readStringUntil('\n');
     patterns_str[i].replace("\r", "");
@@ -96,24 +119,6 @@ void TFTs::loadClockFacesNames()
   f.close();
 }
 
-void TFTs::showNoWifiStatus()
-{
-  chip_select.setSecondsOnes();
-  setTextColor(TFT_RED, TFT_BLACK);
-  fillRect(0, TFT_HEIGHT - 27, TFT_WIDTH, 27, TFT_BLACK);
-  setCursor(5, TFT_HEIGHT - 27, 4); // Font 4. 26 pixel high
-  print("NO WiFi!");
-}
-
-void TFTs::showNoMqttStatus()
-{
-  chip_select.setSecondsTens();
-  setTextColor(TFT_RED, TFT_BLACK);
-  fillRect(0, TFT_HEIGHT - 27, TFT_WIDTH, 27, TFT_BLACK);
-  setCursor(5, TFT_HEIGHT - 27, 4);
-  print("NO MQTT!");
-}
-
 void TFTs::enableAllDisplays()
 {
   // Turn "power" on to displays.
@@ -150,6 +155,48 @@ void TFTs::toggleAllDisplays()
   }
 }
 
+// Same order as the clock draws them, starting with the seconds.
+static const uint8_t DrawOrder[NUM_DIGITS] = {SECONDS_ONES, SECONDS_TENS, MINUTES_ONES, MINUTES_TENS, HOURS_ONES, HOURS_TENS};
+
+void TFTs::setDigits(const uint8_t values[NUM_DIGITS], show_t show)
+{
+  if (!TFTsEnabled)
+    return;
+
+  uint8_t changed = 0; // digit map
+  for (uint8_t i = 0; i < NUM_DIGITS; i++)
+  {
+    uint8_t digit = DrawOrder[i];
+    uint8_t old_value = digits[digit];
+    digits[digit] = values[digit];
+    if (show == no || (old_value == values[digit] && show != force))
+      continue;
+#ifdef DIGIT_TRANSITION
+    if (show == yes && StartTransition(digit, old_value, values[digit]))
+      continue; // drawn by RenderTransitions()
+#endif
+    if (show == force)
+      InvalidateDisplayRows(digit); // send the whole image, whatever was drawn before
+    changed |= 1 << digit;
+  }
+
+  // Digits with the same new value are drawn together, in the order of the first one of each.
+  for (uint8_t i = 0; i < NUM_DIGITS; i++)
+  {
+    uint8_t digit = DrawOrder[i];
+    if (!(changed & (1 << digit)))
+      continue;
+    uint8_t same = 0;
+    for (uint8_t other = 0; other < NUM_DIGITS; other++)
+    {
+      if ((changed & (1 << other)) && digits[other] == digits[digit] && DisplayOverlay(other) == DisplayOverlay(digit))
+        same |= 1 << other;
+    }
+    changed &= ~same;
+    showDigits(same);
+  }
+}
+
 void TFTs::setDigit(uint8_t digit, uint8_t value, show_t show)
 {
   if (TFTsEnabled)
@@ -159,48 +206,228 @@ void TFTs::setDigit(uint8_t digit, uint8_t value, show_t show)
 
     if (show != no && (old_value != value || show == force))
     {
+#ifdef DIGIT_TRANSITION
+      if (show == yes && StartTransition(digit, old_value, value))
+        return; // drawn by RenderTransitions()
+#endif
+      if (show == force)
+        InvalidateDisplayRows(digit); // send the whole image, whatever was drawn before
       showDigit(digit);
+    }
+  }
+}
 
-      if (digit == SECONDS_ONES)
-        if (WifiState != connected)
-        {
-          showNoWifiStatus();
-        }
-
+TFTs::overlay_t TFTs::DisplayOverlay(uint8_t digit)
+{
+  if (digit == HOURS_TENS && MenuShown)
+    return overlay_menu;
+  if (digit == SECONDS_ONES && WifiState != connected)
+    return overlay_no_wifi;
 #if defined(MQTT_PLAIN_ENABLED) || defined(MQTT_HOME_ASSISTANT)
-      if (digit == SECONDS_TENS)
-        if (!MQTTConnected)
-        {
-          showNoMqttStatus();
-        }
+  if (digit == SECONDS_TENS && !MQTTConnected)
+    return overlay_no_mqtt;
+#endif
+  return no_overlay;
+}
+
+// The overlay of the displays in the map (they all have the same), nullptr if there is none. Status overlays are
+// rendered when first needed.
+TFTs::Overlay *TFTs::GetOverlay(uint8_t digit_map)
+{
+  uint8_t digit = 0;
+  while (digit < NUM_DIGITS - 1 && !(digit_map & (1 << digit)))
+    digit++;
+  overlay_t id = DisplayOverlay(digit);
+  if (id == no_overlay)
+    return nullptr;
+  Overlay &overlay = Overlays[id];
+  if (overlay.pixels == nullptr && (id == overlay_menu || !RenderOverlay(id, id == overlay_no_wifi ? "NO WiFi!" : "NO MQTT!")))
+    return nullptr;
+  return &overlay;
+}
+
+// A WiFi symbol, 24 x 18 pixels.
+static const uint8_t IconWifiBits[] = {
+    0xC0, 0xFF, 0x03, 0xF0, 0xFF, 0x0F, 0xFC, 0x00, 0x3F, 0x1E, 0x00, 0x78, 0x0F, 0x00, 0xF0, 0x83, 0xFF, 0xC1,
+    0xE0, 0xFF, 0x07, 0xF0, 0x81, 0x0F, 0x78, 0x00, 0x1E, 0x10, 0x00, 0x08, 0x00, 0xFF, 0x00, 0x80, 0xFF, 0x01,
+    0x80, 0xC3, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x00, 0x3C, 0x00, 0x00, 0x3C, 0x00};
+const TFTs::OverlayIcon TFTs::icon_wifi = {24, 18, IconWifiBits};
+
+// Draws the text with the usual TFT_eSPI functions into a sprite and keeps a copy that can be sent by DMA.
+bool TFTs::RenderOverlay(overlay_t id, const char *text, const OverlayIcon *icon, int8_t progress)
+{
+  Overlay &overlay = Overlays[id];
+  if (overlay.pixels == nullptr)
+  {
+    overlay.first_row = id == overlay_menu ? MENU_FIRST_ROW : TFT_HEIGHT - STATUS_OVERLAY_ROWS;
+    overlay.rows = TFT_HEIGHT - overlay.first_row;
+    uint32_t caps = (DMAEnabled ? MALLOC_CAP_DMA : MALLOC_CAP_INTERNAL) | MALLOC_CAP_8BIT;
+    uint8_t *block = static_cast<uint8_t *>(heap_caps_malloc(overlay.rows * (4 + TFT_WIDTH * 2), caps));
+    if (block == nullptr)
+      return false;
+    overlay.row_hash = reinterpret_cast<uint32_t *>(block);
+    overlay.pixels = reinterpret_cast<uint16_t(*)[TFT_WIDTH]>(block + overlay.rows * 4);
+  }
+
+  TFT_eSprite sprite(this);
+  sprite.setColorDepth(16); // panel byte order, like the image buffers
+  if (sprite.createSprite(TFT_WIDTH, overlay.rows) == nullptr)
+  {
+    ReleaseOverlay(id);
+    return false;
+  }
+  sprite.fillSprite(TFT_BLACK);
+  if (id == overlay_menu)
+  {
+    sprite.setTextColor(TFT_WHITE, TFT_BLACK);
+    sprite.setCursor(0, 4, 4); // Font 4. 26 pixel high
+  }
+  else
+  {
+    sprite.setTextColor(TFT_RED, TFT_BLACK);
+    sprite.setCursor(5, 0, 4);
+  }
+  sprite.print(text);
+  DrawIconAndProgress(sprite, 0, overlay.rows, icon, progress);
+  WaitForImageTransfer(); // the overlay may be on the wire
+  memcpy(overlay.pixels, sprite.getPointer(), overlay.rows * TFT_WIDTH * 2);
+  sprite.deleteSprite();
+
+  for (int16_t row = 0; row < overlay.rows; row++)
+    overlay.row_hash[row] = HashRow(overlay.pixels[row]);
+  return true;
+}
+
+// The icon goes into the lower right corner of the rows, the progress bar along their bottom, left of the icon.
+void TFTs::DrawIconAndProgress(TFT_eSPI &gfx, int16_t top, int16_t rows, const OverlayIcon *icon, int8_t progress)
+{
+  const int16_t margin = 4, bar_height = 12;
+  int16_t bar_end = TFT_WIDTH - margin;
+  if (icon != nullptr)
+  {
+    gfx.drawXBitmap(bar_end - icon->width, top + rows - margin - icon->height, icon->bits, icon->width, icon->height,
+                    TFT_WHITE, TFT_BLACK);
+    bar_end -= icon->width + margin;
+  }
+  if (progress >= 0)
+  {
+    int16_t y = top + rows - margin - bar_height;
+    int16_t width = bar_end - margin;
+    gfx.drawRect(margin, y, width, bar_height, TFT_WHITE);
+    gfx.fillRect(margin + 2, y + 2, (width - 4) * min<int16_t>(progress, 100) / 100, bar_height - 4, TFT_WHITE);
+  }
+}
+
+void TFTs::ReleaseOverlay(overlay_t id)
+{
+  Overlay &overlay = Overlays[id];
+  if (overlay.pixels == nullptr)
+    return;
+  WaitForImageTransfer();
+  heap_caps_free(overlay.row_hash); // start of the allocation
+  overlay.pixels = nullptr;
+  overlay.row_hash = nullptr;
+}
+
+// Sends the rows of the overlay the display doesn't show yet.
+void TFTs::DrawOverlay(uint8_t digit)
+{
+  const Overlay *overlay = GetOverlay(1 << digit);
+  if (overlay == nullptr)
+    return;
+  WaitForImageTransfer();
+  chip_select.setDigit(digit);
+  SendRows(1 << digit, -1, overlay, overlay->first_row, overlay->first_row + overlay->rows);
+#if defined(HARDWARE_IPSTUBE_CLOCK) || defined(HARDWARE_MARVELTUBES_CLOCK)
+  chip_select.update();
 #endif
+}
+
+void TFTs::showMenu(const char *text, const OverlayIcon *icon, int8_t progress)
+{
+  if (!TFTsEnabled)
+    return;
+  bool changed = !MenuShown || MenuText != text || MenuIcon != icon || MenuProgress != progress;
+  MenuShown = true;
+  if (changed)
+  {
+    MenuText = text;
+    MenuIcon = icon;
+    MenuProgress = progress;
+    if (!RenderOverlay(overlay_menu, text, icon, progress))
+    { // not enough RAM: straight onto the display, a transition or redraw of the digit may cover it
+      FinishTransitions();
+      WaitForImageTransfer();
+      chip_select.setHoursTens();
+      setTextColor(TFT_WHITE, TFT_BLACK);
+      fillRect(0, MENU_FIRST_ROW, TFT_WIDTH, TFT_HEIGHT - MENU_FIRST_ROW, TFT_BLACK);
+      setCursor(0, MENU_FIRST_ROW + 4, 4);
+      print(text);
+      DrawIconAndProgress(*this, MENU_FIRST_ROW, TFT_HEIGHT - MENU_FIRST_ROW, icon, progress);
+      InvalidateDisplayRows(HOURS_TENS, MENU_FIRST_ROW, TFT_HEIGHT - MENU_FIRST_ROW);
+      return;
     }
   }
+  DrawOverlay(HOURS_TENS);
+}
+
+void TFTs::hideMenu()
+{
+  if (!MenuShown)
+    return;
+  MenuShown = false;
+  MenuText = "";
+  MenuIcon = nullptr;
+  MenuProgress = -1;
+  ReleaseOverlay(overlay_menu);
+  showDigit(HOURS_TENS); // the rows under the menu
 }
 
 /*
- * Displays the bitmap for the value to the given digit.
+ * Displays the bitmap for the value to the given digits, which all have the same value. Their displays are selected
+ * together, so the image goes over the SPI bus once for all of them.
+ * The image is decoded before the chip select is switched, so with DMA the decoding overlaps the transfer of the previous digit.
+ * In band mode (TFT_BAND_ROWS) the image is decoded while it is sent, band by band.
  */
 
-void TFTs::showDigit(uint8_t digit)
+void TFTs::showDigits(uint8_t digit_map)
 {
-  if (TFTsEnabled)
+  if (TFTsEnabled && digit_map != 0)
   { // only do this, if the displays are enabled
-    chip_select.setDigit(digit);
+    uint8_t value = 0;
+    for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+    {
+      if (digit_map & (1 << digit))
+      {
+        value = digits[digit];
+#ifdef DIGIT_TRANSITION
+        Transitions[digit].active = false; // the digit is drawn completely now
+#endif
+      }
+    }
+#ifndef TFT_BAND_ROWS
+    uint8_t buffer = 0;
+    if (value != blanked)
+    {
+      buffer = PrepareImage(current_graphic * 10 + value);
+    }
+#endif
 
-    if (digits[digit] == blanked)
-    { // Blank Zero
-      fillScreen(TFT_BLACK);
+    WaitForImageTransfer(); // previous digit must be completely sent before its CS is released
+
+    if (value == blanked)
+    { // Blank Zero: black where the displays show something else
+      chip_select.setDigits(digit_map);
+      SendRows(digit_map, -1, GetOverlay(digit_map), 0, TFT_HEIGHT);
     }
     else
     {
-      uint8_t file_index = current_graphic * 10 + digits[digit];
-      DrawImage(file_index);
-
-      uint8_t NextNumber = digits[SECONDS_ONES] + 1;
-      if (NextNumber > 9)
-        NextNumber = 0; // pre-load only seconds, because they are drawn first
-      NextFileRequired = current_graphic * 10 + NextNumber;
+      chip_select.setDigits(digit_map);
+#ifndef TFT_BAND_ROWS
+      DrawImage(digit_map, buffer);
+#else
+      DrawImageBands(digit_map, current_graphic * 10 + value);
+#endif
     }
 #if defined(HARDWARE_IPSTUBE_CLOCK) || defined(HARDWARE_MARVELTUBES_CLOCK)
     chip_select.update();
@@ -209,20 +436,88 @@ void TFTs::showDigit(uint8_t digit)
   // else { } //display is disabled, do nothing
 }
 
+#ifndef TFT_BAND_ROWS
+void TFTs::PlanPrefetch(const uint8_t next_digits[NUM_DIGITS], uint32_t ms_to_next_second)
+{
+  PrefetchCount = 0;
+  for (uint8_t i = 0; i < NUM_DIGITS; i++)
+  {
+    uint8_t digit = DrawOrder[i];
+    if (next_digits[digit] == digits[digit] || next_digits[digit] == blanked)
+      continue;
+    uint8_t file_index = current_graphic * 10 + next_digits[digit];
+    if (!IsPrefetched(file_index)) // at a rollover most digits go to the same "0"
+      PrefetchFiles[PrefetchCount++] = file_index;
+  }
+  PrefetchDeadline = millis() + ms_to_next_second;
+}
+
+bool TFTs::IsPrefetched(uint8_t file_index)
+{
+  for (uint8_t i = 0; i < PrefetchCount; i++)
+  {
+    if (PrefetchFiles[i] == file_index)
+      return true;
+  }
+  return false;
+}
+
+// Loads one image of the next second into a buffer, most urgent first. With nothing left to load, fills the glyph cache.
 void TFTs::LoadNextImage()
 {
-  if (NextFileRequired != FileInBuffer)
+  if (NumberOfImageBuffers > NumberOfFixedBuffers &&
+      heap_caps_get_free_size((DMAEnabled ? MALLOC_CAP_DMA : MALLOC_CAP_INTERNAL) | MALLOC_CAP_8BIT) < IMAGE_PREFETCH_MIN_FREE_HEAP)
+    ReleasePrefetchBuffer(); // one per call, the next one if it is still not enough
+
+  for (uint8_t i = 0; i < PrefetchCount; i++)
   {
+    if (FindImageBuffer(PrefetchFiles[i]) >= 0)
+      continue;
+    int8_t buffer = FindPrefetchBuffer();
+    if (buffer < 0)
+      break; // all buffers hold images of the next second, the rest is loaded when drawn
 #ifdef DEBUG_OUTPUT_IMAGES
-    Serial.println("Preload next img");
+    Serial.print("Preload next img: ");
+    Serial.println(PrefetchFiles[i]);
 #endif
-    LoadImageIntoBuffer(NextFileRequired);
+    LoadImageIntoBuffer(PrefetchFiles[i], buffer);
+    return; // one image per call
   }
+#ifdef GLYPH_CACHE
+  // Images for later seconds only if the next second can't be delayed by it.
+  if (int32_t(PrefetchDeadline - millis()) > int32_t(ImageLoadMs))
+    FillGlyphCache();
+#endif
 }
+#else
+// Band mode: every image is read from the flash while it is drawn, there is nothing to load ahead.
+void TFTs::PlanPrefetch(const uint8_t next_digits[NUM_DIGITS], uint32_t ms_to_next_second) {}
+void TFTs::LoadNextImage() {}
+void TFTs::EnablePrefetchBuffers() {}
+#endif // TFT_BAND_ROWS
 
 void TFTs::InvalidateImageInBuffer()
-{                     // force reload from Flash with new dimming settings
-  FileInBuffer = 255; // invalid, always load first image
+{ // force reload from Flash
+#ifndef TFT_BAND_ROWS
+  for (uint8_t i = 0; i < MAX_IMAGE_BUFFERS; i++)
+    FileInBuffer[i] = 255; // invalid, always load first image
+#endif
+#ifdef GLYPH_CACHE
+  GlyphCacheValid = 0;
+  GlyphCacheFailed = 0;
+#endif
+}
+
+void TFTs::WaitForImageTransfer()
+{
+#ifdef TFT_USE_DMA
+  if (BufferInTransfer >= 0)
+  {
+    dmaWait();
+    endWrite(); // release the SPI bus taken in DrawImage()
+    BufferInTransfer = -1;
+  }
+#endif
 }
 
 void TFTs::ProcessUpdatedDimming()
@@ -240,10 +535,68 @@ void TFTs::ProcessUpdatedDimming()
     ledcWrite(TFT_PWM_CHANNEL, CALCDIMVALUE(0));
   }
 #else
-  // "software" dimming is done via alpha blending in the image drawing function
-  // signal that the image in the buffer is invalid and needs to be reloaded and refilled
-  InvalidateImageInBuffer();
+  // "software" dimming is done while the images are sent, see PushImageRows(). The buffers stay valid.
+#endif
+}
+
+// Hash of an image row as it appears on the display with the current dimming. Dimmed rows get a different hash
+// than undimmed ones, so they are sent again after a brightness change. Black stays black.
+uint32_t TFTs::ShownRowHash(uint32_t image_row_hash)
+{
+#ifndef DIM_WITH_ENABLE_PIN_PWM
+  if (dimming != 255 && image_row_hash != 0 && image_row_hash != BlackRowHash)
+  {
+    uint32_t hash = (image_row_hash ^ dimming) * 16777619UL;
+    return hash ? hash : 1;
+  }
+#endif
+  return image_row_hash;
+}
+
+#ifndef DIM_WITH_ENABLE_PIN_PWM
+// Copies pixels (panel byte order) and dims them, two pixels (one 32 bit word) at a time: the channels of both
+// pixels are scaled with one multiply each. Same results as alphaBlend() (BMP) and the CLK dimming.
+// Black pairs, most of a clock digit, are just copied.
+void TFTs::DimPixels(const uint16_t *source, uint16_t *target, uint32_t pixels)
+{
+#ifdef USE_CLK_FILES
+  uint32_t alphaRB = dimming;
+#else
+  uint32_t alphaRB = dimming & 0xFC; // alphaBlend() uses a 6 bit alpha for red and blue
+#endif
+  uint32_t alphaG = dimming;
+  for (uint32_t i = 0; i < pixels; i += 2)
+  {
+    uint32_t pair = source[i];
+    if (i + 1 < pixels)
+      memcpy(&pair, &source[i], 4); // source may not be 32 bit aligned, TFT_WIDTH is odd
+    if (pair != 0)
+    {
+      pair = ((pair & 0x00FF00FF) << 8) | ((pair >> 8) & 0x00FF00FF); // panel order -> RGB565, both pixels
+      uint32_t r = ((((pair >> 11) & 0x001F001F) * alphaRB) >> 8) & 0x001F001F;
+      uint32_t g = ((((pair >> 5) & 0x003F003F) * alphaG) >> 8) & 0x003F003F;
+      uint32_t b = (((pair & 0x001F001F) * alphaRB) >> 8) & 0x001F001F;
+      pair = (r << 11) | (g << 5) | b;
+      pair = ((pair & 0x00FF00FF) << 8) | ((pair >> 8) & 0x00FF00FF);
+    }
+    if (i + 1 < pixels)
+      memcpy(&target[i], &pair, 4);
+    else
+      target[i] = pair; // odd number of pixels, last one
+  }
+}
+#endif
+
+void TFTs::CopyShownRow(const uint16_t *row, uint16_t *out)
+{
+#ifndef DIM_WITH_ENABLE_PIN_PWM
+  if (dimming != 255)
+  {
+    DimPixels(row, out, TFT_WIDTH);
+    return;
+  }
 #endif
+  memcpy(out, row, TFT_WIDTH * 2);
 }
 
 bool TFTs::FileExists(const char *path)
@@ -259,39 +612,103 @@ bool TFTs::FileExists(const char *path)
 // I've modified DrawImage to buffer the whole image at once instead of doing it line-by-line.
 
 // Too big to fit on the stack.
-uint16_t TFTs::UnpackedImageBuffer[TFT_HEIGHT][TFT_WIDTH];
-
-#ifndef USE_CLK_FILES
+#ifndef TFT_BAND_ROWS
+alignas(4) uint16_t TFTs::UnpackedImageBuffer[TFT_HEIGHT][TFT_WIDTH];
+#endif
+#if !defined(DIM_WITH_ENABLE_PIN_PWM) || defined(DIGIT_TRANSITION) || defined(TFT_BAND_ROWS)
+alignas(4) uint16_t TFTs::SendStripe[2][SEND_STRIPE_ROWS][TFT_WIDTH];
+#endif
+alignas(4) uint8_t TFTs::ImageReadBuffer[IMAGE_READ_CHUNK + IMAGE_READ_MAX_TAKE];
 
 int8_t TFTs::CountNumberOfClockFaces()
 {
   int8_t i, found;
   char filename[10];
 
-  Serial.print("Searching for BMP clock files... ");
+  if (OpenClockFacePack())
+  {
+    Serial.print(NumberOfPackedFaces);
+    Serial.println(" fonts found in " CLOCK_FACE_PACK);
+    return NumberOfPackedFaces;
+  }
+
+  Serial.print("Searching for " IMAGE_FILE_TYPE " clock files... ");
   found = 0;
-  for (i = 1; i < 10; i++)
+  for (i = 1; i <= MAX_CLOCK_FACES; i++)
   {
-    sprintf(filename, "/%d.bmp", i * 10); // search for files 10.bmp, 20.bmp,...
+    sprintf(filename, "/%d." IMAGE_FILE_EXTENSION, i * 10); // search for files 10.bmp, 20.bmp,...
     if (!FileExists(filename))
     {
-      found = i - 1;
       break;
     }
+    found = i;
   }
   Serial.print(found);
   Serial.println(" fonts found.");
   return found;
 }
 
-bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
+// The clock face pack holds all images in one file, with an index of offsets. It is opened once and kept open,
+// so loading a digit is just a seek and a read, without any file system lookup. Layout: see tools/pack-clock-faces.py.
+bool TFTs::OpenClockFacePack()
 {
-  uint32_t StartTime = millis();
+  fs::File pack = LittleFS.open(CLOCK_FACE_PACK, "r");
+  if (!pack || pack.isDirectory())
+    return false;
+
+  uint8_t header[8]; // magic, version, faces, reserved
+  uint32_t magic = 0;
+  if (pack.read(header, sizeof(header)) == sizeof(header))
+    memcpy(&magic, header, sizeof(magic)); // little endian, like the ESP32
+  uint8_t version = header[4];
+  uint8_t faces = header[5];
+  if (magic != CLOCK_FACE_PACK_MAGIC || version != 1 || faces == 0)
+  {
+    Serial.println("Clock face pack not valid, ignored.");
+    pack.close();
+    return false;
+  }
+  if (faces > MAX_CLOCK_FACES)
+    faces = MAX_CLOCK_FACES;
+
+  size_t indexSize = faces * 10 * sizeof(PackIndex[0]);
+  if (pack.read(reinterpret_cast<uint8_t *>(PackIndex), indexSize) != indexSize) // little endian, like the ESP32
+  {
+    Serial.println("Clock face pack index truncated, ignored.");
+    pack.close();
+    return false;
+  }
+  PackFile = pack;
+  NumberOfPackedFaces = faces;
+  return true;
+}
+
+bool TFTs::OpenImageFile(uint8_t file_index, ImageFile &img)
+{
+  img.index = file_index;
+  if (PackFile)
+  {
+    uint8_t face = file_index / 10;
+    if (face < 1 || face > NumberOfPackedFaces || PackIndex[(face - 1) * 10 + file_index % 10].size == 0)
+    {
+      Serial.print("Image not in clock face pack: ");
+      Serial.println(file_index);
+      return (false);
+    }
+    img.offset = PackIndex[(face - 1) * 10 + file_index % 10].offset;
+    img.size = PackIndex[(face - 1) * 10 + file_index % 10].size;
+    img.file = PackFile;
+    img.file.seek(img.offset);
+#ifdef DEBUG_OUTPUT_IMAGES
+    Serial.print("Loading from pack: ");
+    Serial.println(file_index);
+#endif
+    return (true);
+  }
 
-  fs::File bmpFS;
   // Filenames are no bigger than "255.bmp\0"
   char filename[10];
-  sprintf(filename, "/%d.bmp", file_index);
+  sprintf(filename, "/%d." IMAGE_FILE_EXTENSION, file_index);
 
 #ifdef DEBUG_OUTPUT_IMAGES
   Serial.print("Loading: ");
@@ -299,27 +716,56 @@ bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
 #endif
 
   // Open requested file on SD card
-  bmpFS = LittleFS.open(filename, "r");
-  if (!bmpFS)
+  img.file = LittleFS.open(filename, "r");
+  if (!img.file)
   {
     Serial.print("File not found: ");
     Serial.println(filename);
     return (false);
   }
+  img.offset = 0;
+  img.size = img.file.size();
+  return (true);
+}
+
+bool TFTs::DecodeImageFile(uint8_t file_index, uint16_t (*image)[TFT_WIDTH])
+{
+  uint32_t StartTime = millis();
+
+  ImageFile img;
+  if (!OpenImageFile(file_index, img))
+    return (false);
+
+  bool decoded = DecodeImageData(img, image);
+  if (!PackFile)
+    img.file.close(); // the pack stays open
+
+#ifdef DEBUG_OUTPUT_IMAGES
+  Serial.print("img load time: ");
+  Serial.println(millis() - StartTime);
+#endif
+  return decoded;
+}
+
+#ifndef USE_CLK_FILES
+
+bool TFTs::DecodeImageData(ImageFile &img, uint16_t (*image)[TFT_WIDTH])
+{
+  BufferedReader bmpFS(img.file, img.offset, img.offset + img.size, ImageReadBuffer, IMAGE_READ_CHUNK, IMAGE_READ_MAX_TAKE);
 
   uint32_t seekOffset, headerSize, paletteSize = 0;
   int16_t w, h, row, col;
   uint16_t r, g, b, bitDepth;
 
-  // black background - clear whole buffer
-  memset(UnpackedImageBuffer, '\0', sizeof(UnpackedImageBuffer));
+  // black background - clear whole buffer (in band mode each band starts black)
+  if (image != nullptr)
+    memset(image, '\0', sizeof(uint16_t) * TFT_WIDTH * TFT_HEIGHT);
 
-  uint16_t magic = read16(bmpFS);
+  uint16_t magic = bmpFS.read16();
   if (magic == 0xFFFF)
   {
     Serial.print("Can't openfile. Make sure you upload the LittleFS image with BMPs. : ");
-    Serial.println(filename);
-    bmpFS.close();
+    Serial.println(img.index);
     return (false);
   }
 
@@ -327,18 +773,17 @@ bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
   {
     Serial.print("File not a BMP. Magic: ");
     Serial.println(magic);
-    bmpFS.close();
     return (false);
   }
 
-  read32(bmpFS);              // filesize in bytes
-  read32(bmpFS);              // reserved
-  seekOffset = read32(bmpFS); // start of bitmap
-  headerSize = read32(bmpFS); // header size
-  w = read32(bmpFS);          // width
-  h = read32(bmpFS);          // height
-  read16(bmpFS);              // color planes (must be 1)
-  bitDepth = read16(bmpFS);
+  bmpFS.read32();              // filesize in bytes
+  bmpFS.read32();              // reserved
+  seekOffset = bmpFS.read32(); // start of bitmap
+  headerSize = bmpFS.read32(); // header size
+  w = bmpFS.read32();          // width
+  h = bmpFS.read32();          // height
+  bmpFS.read16();              // color planes (must be 1)
+  bitDepth = bmpFS.read16();
 
   // center image on the display
   int16_t x = (TFT_WIDTH - w) / 2;
@@ -358,39 +803,51 @@ bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
   Serial.print(", ");
   Serial.println(y);
 #endif
-  if (read32(bmpFS) != 0 || (bitDepth != 24 && bitDepth != 1 && bitDepth != 4 && bitDepth != 8))
+  if (bmpFS.read32() != 0 || (bitDepth != 24 && bitDepth != 1 && bitDepth != 4 && bitDepth != 8))
   {
     Serial.println("BMP format not recognized.");
-    bmpFS.close();
     return (false);
   }
 
-  uint32_t palette[256];
+  // 1,4,8 bit bitmaps: the palette is converted once, the pixels are just looked up
+  uint16_t palette[256];
   if (bitDepth <= 8) // 1,4,8 bit bitmap: read color palette
   {
-    read32(bmpFS);
-    read32(bmpFS);
-    read32(bmpFS); // size, w resolution, h resolution
-    paletteSize = read32(bmpFS);
-    if (paletteSize == 0)
-      paletteSize = pow(2, bitDepth); // if 0, size is 2^bitDepth
-    bmpFS.seek(14 + headerSize);      // start of color palette
+    bmpFS.read32();
+    bmpFS.read32();
+    bmpFS.read32(); // size, w resolution, h resolution
+    paletteSize = bmpFS.read32();
+    if (paletteSize == 0 || paletteSize > 256)
+      paletteSize = 1 << bitDepth; // if 0, size is 2^bitDepth
+    bmpFS.seek(14 + headerSize);   // start of color palette
+    const uint8_t *paletteData = bmpFS.take(paletteSize * 4);
+    if (paletteData == nullptr)
+    {
+      Serial.println("BMP palette truncated.");
+      return (false);
+    }
     for (uint16_t i = 0; i < paletteSize; i++)
     {
-      palette[i] = read32(bmpFS);
+      const uint8_t *c = &paletteData[i * 4]; // B, G, R, unused
+      palette[i] = toPanelOrder(((c[2] & 0xF8) << 8) | ((c[1] & 0xFC) << 3) | (c[0] >> 3));
     }
   }
 
   bmpFS.seek(seekOffset);
 
   uint32_t lineSize = ((bitDepth * w + 31) >> 5) * 4;
-  uint8_t lineBuffer[lineSize];
 
   // row is decremented as the BMP image is drawn bottom up
   for (row = h - 1; row >= 0; row--)
   {
-    bmpFS.read(lineBuffer, sizeof(lineBuffer));
-    uint8_t *bptr = lineBuffer;
+    const uint8_t *bptr = bmpFS.take(lineSize);
+    if (bptr == nullptr)
+    {
+      Serial.println("BMP data truncated.");
+      break; // keep the rest black
+    }
+
+    uint16_t *out = ImageRow(image, row + y) + x;
 
     // Convert 24 to 16 bit colours while copying to output buffer.
     for (col = 0; col < w; col++)
@@ -400,134 +857,102 @@ bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
         b = *bptr++;
         g = *bptr++;
         r = *bptr++;
+        out[col] = toPanelOrder(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
       }
-      else
+      else if (bitDepth == 8)
       {
-        uint32_t c = 0;
-        if (bitDepth == 8)
-        {
-          c = palette[*bptr++];
-        }
-        else if (bitDepth == 4)
-        {
-          c = palette[(*bptr >> ((col & 0x01) ? 0 : 4)) & 0x0F];
-          if (col & 0x01)
-            bptr++;
-        }
-        else
-        { // bitDepth == 1
-          c = palette[(*bptr >> (7 - (col & 0x07))) & 0x01];
-          if ((col & 0x07) == 0x07)
-            bptr++;
-        }
-        b = c;
-        g = c >> 8;
-        r = c >> 16;
+        out[col] = palette[*bptr++];
+      }
+      else if (bitDepth == 4)
+      {
+        out[col] = palette[(*bptr >> ((col & 0x01) ? 0 : 4)) & 0x0F];
+        if (col & 0x01)
+          bptr++;
+      }
+      else
+      { // bitDepth == 1
+        out[col] = palette[(*bptr >> (7 - (col & 0x07))) & 0x01];
+        if ((col & 0x07) == 0x07)
+          bptr++;
       }
-
-      uint16_t color = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | ((b & 0xFF) >> 3);
-#ifndef DIM_WITH_ENABLE_PIN_PWM // skip alpha blending for dimming if hardware dimming is used
-      if (dimming < 255)
-      { // only dim when needed
-        color = alphaBlend(dimming, color, TFT_BLACK);
-      } // dimming
-#endif
-
-      UnpackedImageBuffer[row + y][col + x] = color;
     } // col
   } // row
-  FileInBuffer = file_index;
 
-  bmpFS.close();
-#ifdef DEBUG_OUTPUT_IMAGES
-  Serial.print("img load time: ");
-  Serial.println(millis() - StartTime);
-#endif
   return (true);
 }
 #endif
 
 #ifdef USE_CLK_FILES
 
-int8_t TFTs::CountNumberOfClockFaces()
-{
-  int8_t i, found;
-  char filename[10];
-
-  Serial.print("Searching for CLK clock files... ");
-  found = 0;
-  for (i = 1; i < 10; i++)
-  {
-    sprintf(filename, "/%d.clk", i * 10); // search for files 10.clk, 20.clk,...
-    if (!FileExists(filename))
-    {
-      found = i - 1;
-      break;
-    }
-  }
-  Serial.print(found);
-  Serial.println(" fonts found.");
-  return found;
-}
-
-bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
+bool TFTs::DecodeImageData(ImageFile &img, uint16_t (*image)[TFT_WIDTH])
 {
-  uint32_t StartTime = millis();
-
-  fs::File bmpFS;
-  // Filenames are no bigger than "255.clk\0"
-  char filename[10];
-  sprintf(filename, "/%d.clk", file_index);
-
-#ifdef DEBUG_OUTPUT_IMAGES
-  Serial.print("Loading: ");
-  Serial.println(filename);
-#endif
-
-  // Open requested file on SD card
-  bmpFS = LittleFS.open(filename, "r");
-  if (!bmpFS)
-  {
-    Serial.print("File not found: ");
-    Serial.println(filename);
-    return (false);
-  }
+  BufferedReader bmpFS(img.file, img.offset, img.offset + img.size, ImageReadBuffer, IMAGE_READ_CHUNK, IMAGE_READ_MAX_TAKE);
 
   int16_t w, h, row, col;
-  uint16_t r, g, b;
+  uint8_t compression = CLK_COMPRESSION_NONE;
 
-  // black background - clear whole buffer
-  memset(UnpackedImageBuffer, '\0', sizeof(UnpackedImageBuffer));
+  // black background - clear whole buffer (in band mode each band starts black)
+  if (image != nullptr)
+    memset(image, '\0', sizeof(uint16_t) * TFT_WIDTH * TFT_HEIGHT);
 
-  uint16_t magic = read16(bmpFS);
+  uint16_t magic = bmpFS.read16();
   if (magic == 0xFFFF)
   {
     Serial.print("Can't openfile. Make sure you upload the LittleFS image with images. : ");
-    Serial.println(filename);
-    bmpFS.close();
+    Serial.println(img.index);
     return (false);
   }
 
-  if (magic != 0x4B43)
-  { // look for "CK" header
+  if (magic == 0x4B43)
+  { // "CK" header: version 1, raw pixels
+    w = bmpFS.read16();
+    h = bmpFS.read16();
+  }
+  else if (magic == 0x3243)
+  { // "C2" header: version 2, see tools/conv-bmp-to-clk.py for the layout
+    uint8_t version = bmpFS.read8();
+    compression = bmpFS.read8();
+    w = bmpFS.read16();
+    h = bmpFS.read16();
+    bmpFS.read32(); // reserved
+    if (version != 2 || compression > CLK_COMPRESSION_PALETTE)
+    {
+      Serial.print("CLK version/compression not supported: ");
+      Serial.print(version);
+      Serial.print("/");
+      Serial.println(compression);
+      return (false);
+    }
+  }
+  else
+  { // look for "CK" or "C2" header
     Serial.print("File not a CLK. Magic: ");
     Serial.println(magic);
-    bmpFS.close();
     return (false);
   }
 
-  w = read16(bmpFS);
-  h = read16(bmpFS);
+  if (w <= 0 || h <= 0)
+  {
+    Serial.println("CLK image size invalid.");
+    return (false);
+  }
+  if (w > TFT_WIDTH || h > TFT_HEIGHT)
+  {
+    Serial.println("CLK image too big.");
+    return (false);
+  }
 
   // center image on the display
   int16_t x = (TFT_WIDTH - w) / 2;
   int16_t y = (TFT_HEIGHT - h) / 2;
 
 #ifdef DEBUG_OUTPUT_IMAGES
-  Serial.print(" image W, H: ");
+  Serial.print(" image W, H, compression: ");
   Serial.print(w);
   Serial.print(", ");
-  Serial.println(h);
+  Serial.print(h);
+  Serial.print(", ");
+  Serial.println(compression);
   Serial.print(" dimming: ");
   Serial.println(dimming);
   Serial.print(" offset x, y: ");
@@ -536,105 +961,1036 @@ bool TFTs::LoadImageIntoBuffer(uint8_t file_index)
   Serial.println(y);
 #endif
 
-  uint8_t lineBuffer[w * 2];
-
+  // Compressed rows may be slightly longer than raw ones (one packet header per 128 pixels)
+  const uint32_t maxRowSize = w * 2 + 4;
+  uint32_t rowOffset[TFT_HEIGHT + 1]; // only used by version 2
+  if (magic == 0x3243)
+  {
+    if (!bmpFS.read(rowOffset, 4 * h)) // little endian, like the ESP32
+    {
+      Serial.println("CLK row offsets truncated.");
+      return (false);
+    }
+    rowOffset[h] = img.size; // offsets are relative to the start of the image
+  }
+  uint16_t palette[256]; // like the BMP palette, only used with CLK_COMPRESSION_PALETTE
+  if (compression == CLK_COMPRESSION_PALETTE)
+  {
+    uint16_t colors = min<uint16_t>(bmpFS.read16(), 256);
+    memset(palette, 0, sizeof(palette));  // indexes beyond the palette are black
+    bmpFS.read(palette, 2 * colors);      // little endian, like the ESP32
+    for (uint16_t i = 0; i < colors; i++)
+      palette[i] = toPanelOrder(palette[i]);
+  }
   // 0,0 coordinates are top left
   for (row = 0; row < h; row++)
   {
-    bmpFS.read(lineBuffer, sizeof(lineBuffer));
-    uint8_t PixM, PixL;
+    uint16_t *pixels = ImageRow(image, row + y) + x;
+    if (magic == 0x3243)
+      bmpFS.seek(rowOffset[row]); // rows are stored back to back, so this reads nothing: the row is in the buffer already
 
-    // Colors are already in 16-bit R5, G6, B5 format
-    for (col = 0; col < w; col++)
+    if (compression == CLK_COMPRESSION_NONE)
+    {
+      const uint8_t *lineBuffer = bmpFS.take(w * 2);
+      if (lineBuffer == nullptr)
+      {
+        Serial.println("CLK data truncated.");
+        break; // keep the rest black
+      }
+      // Colors are already in 16-bit R5, G6, B5 format
+      for (col = 0; col < w; col++)
+      {
+        pixels[col] = ClkPixel(lineBuffer[col * 2], lineBuffer[col * 2 + 1]);
+      } // col
+    }
+    else if (compression == CLK_COMPRESSION_PALETTE)
+    {
+      const uint8_t *lineBuffer = bmpFS.take(w);
+      if (lineBuffer == nullptr)
+      {
+        Serial.println("CLK data truncated.");
+        break; // keep the rest black
+      }
+      for (col = 0; col < w; col++)
+        pixels[col] = palette[lineBuffer[col]];
+    }
+    else
+    {
+      uint32_t rowSize = rowOffset[row + 1] - rowOffset[row];
+      const uint8_t *lineBuffer = rowSize <= maxRowSize ? bmpFS.take(rowSize) : nullptr;
+      if (lineBuffer == nullptr)
+      {
+        Serial.println("CLK row data corrupt.");
+        break; // keep the rest black
+      }
+      // RLE packets: header byte with bit 7 set is a run of ((header & 0x7F) + 1) times the following pixel,
+      // else a literal of (header + 1) pixels follows. Packets never cross a row.
+      const uint8_t *packet = lineBuffer;
+      const uint8_t *rowEnd = lineBuffer + rowSize;
+      col = 0;
+      while (col < w && packet < rowEnd)
+      {
+        uint8_t header = *packet++;
+        uint8_t count = (header & 0x7F) + 1;
+        if (count > w - col)
+          count = w - col;
+        if (header & 0x80)
+        {
+          if (rowEnd - packet < 2)
+            break;
+          uint16_t color = ClkPixel(packet[0], packet[1]);
+          packet += 2;
+          while (count--)
+            pixels[col++] = color;
+        }
+        else
+        {
+          if (rowEnd - packet < count * 2)
+            break;
+          for (uint8_t i = 0; i < count; i++, packet += 2)
+            pixels[col++] = ClkPixel(packet[0], packet[1]);
+        }
+      }
+    }
+  } // row
+
+  return (true);
+}
+
+// Converts a little endian RGB565 pixel from a CLK file to panel byte order.
+uint16_t TFTs::ClkPixel(uint8_t PixL, uint8_t PixM)
+{
+  return (PixL << 8) | PixM;
+}
+#endif
+
+#ifndef TFT_BAND_ROWS
+bool TFTs::LoadImageIntoBuffer(uint8_t file_index, uint8_t buffer)
+{
+  FileInBuffer[buffer] = 255;                                    // invalid until completely loaded
+  memset(ImageRowHash[buffer], 0, sizeof(ImageRowHash[buffer])); // rows are unknown until hashed
+
+#ifdef GLYPH_CACHE
+  if (LoadFromGlyphCache(file_index, buffer))
+  {
+    FileInBuffer[buffer] = file_index;
+    return (true);
+  }
+#endif
+
+  uint32_t StartTime = millis();
+  if (!DecodeImageFile(file_index, ImageBuffer[buffer]))
+    return (false);
+  ImageLoadMs = (3 * ImageLoadMs + (millis() - StartTime)) / 4;
+  HashImageRows(buffer);
+  FileInBuffer[buffer] = file_index;
+
+#ifdef GLYPH_CACHE
+  StoreInGlyphCache(file_index, buffer);
+#endif
+  return (true);
+}
+#endif // TFT_BAND_ROWS
+
+#ifdef GLYPH_CACHE
+void TFTs::AllocateGlyphCache()
+{
+  if (GlyphCache != nullptr || !psramFound())
+    return;
+
+  size_t size = 10 * sizeof(CachedGlyph);
+  if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) < size + GLYPH_CACHE_MIN_FREE_PSRAM)
+  {
+    Serial.println("Not enough free PSRAM for the glyph cache.");
+    return;
+  }
+  GlyphCache = static_cast<CachedGlyph *>(heap_caps_malloc(size, MALLOC_CAP_SPIRAM));
+  GlyphCacheValid = 0;
+  GlyphCacheFailed = 0;
+  if (GlyphCache != nullptr)
+  {
+    for (uint8_t i = 0; i < 10; i++)
+      GlyphCache[i].wide = nullptr;
+  }
+  Serial.println(GlyphCache != nullptr ? "Glyph cache allocated in PSRAM." : "Glyph cache allocation failed.");
+}
+
+void TFTs::ReleaseGlyphCache()
+{
+  if (GlyphCache == nullptr)
+    return;
+  for (uint8_t i = 0; i < 10; i++)
+  {
+    if (GlyphCache[i].wide != nullptr)
+      heap_caps_free(GlyphCache[i].wide);
+  }
+  heap_caps_free(GlyphCache);
+  GlyphCache = nullptr;
+  GlyphCacheValid = 0;
+  Serial.println("Low on PSRAM, glyph cache released. Loading images from flash again.");
+}
+
+// Returns the cache entry for the image, if it is one of the digits of the active clock face. Empties the cache when the face has changed.
+TFTs::CachedGlyph *TFTs::GlyphCacheEntry(uint8_t file_index)
+{
+  if (GlyphCache == nullptr || file_index / 10 != current_graphic)
+    return nullptr;
+  if (GlyphCacheFace != current_graphic)
+  {
+    GlyphCacheFace = current_graphic;
+    GlyphCacheValid = 0;
+    GlyphCacheFailed = 0;
+  }
+  return &GlyphCache[file_index % 10];
+}
+
+bool TFTs::LoadFromGlyphCache(uint8_t file_index, uint8_t buffer)
+{
+  CachedGlyph *glyph = GlyphCacheEntry(file_index);
+  if (glyph == nullptr || !(GlyphCacheValid & (1 << (file_index % 10))))
+    return false;
+#ifdef DEBUG_OUTPUT_IMAGES
+  Serial.print("Glyph cache hit: ");
+  Serial.println(file_index);
+#endif
+  for (int16_t row = 0; row < TFT_HEIGHT; row++)
+    ExpandGlyphRow(glyph, row, ImageBuffer[buffer][row], false);
+  memcpy(ImageRowHash[buffer], glyph->row_hash, sizeof(glyph->row_hash));
+  return true;
+}
+
+void TFTs::StoreInGlyphCache(uint8_t file_index, uint8_t buffer)
+{
+  CachedGlyph *glyph = GlyphCacheEntry(file_index);
+  if (glyph == nullptr)
+    return;
+  uint16_t bit = 1 << (file_index % 10);
+  GlyphCacheValid &= ~bit;
+  if (!IndexGlyph(glyph, ImageBuffer[buffer]))
+  { // more than 256 colors: keep the RGB565 pixels
+    if (glyph->wide == nullptr && heap_caps_get_free_size(MALLOC_CAP_SPIRAM) >= sizeof(UnpackedImageBuffer) + GLYPH_CACHE_MIN_FREE_PSRAM)
+      glyph->wide = static_cast<uint16_t(*)[TFT_WIDTH]>(heap_caps_malloc(sizeof(UnpackedImageBuffer), MALLOC_CAP_SPIRAM));
+    if (glyph->wide == nullptr)
+    {
+      GlyphCacheFailed |= bit;
+      return;
+    }
+    memcpy(glyph->wide, ImageBuffer[buffer], sizeof(UnpackedImageBuffer));
+    glyph->colors = 0;
+  }
+#ifndef DIM_WITH_ENABLE_PIN_PWM
+  glyph->palette_dimming = 255;
+#endif
+  memcpy(glyph->row_hash, ImageRowHash[buffer], sizeof(glyph->row_hash));
+  GlyphCacheValid |= bit;
+}
+
+// Puts the palette of the image and one palette index per pixel into the glyph. False if there are more than 256 colors.
+bool TFTs::IndexGlyph(CachedGlyph *glyph, const uint16_t (*image)[TFT_WIDTH])
+{
+  // Open addressing hash table of the colors found so far. Neighbouring pixels mostly have the same color, which
+  // skips the lookup.
+  static const uint16_t slots = 512;
+  static uint16_t slot_color[slots];
+  static uint16_t slot_index[slots]; // 0xFFFF: free
+  memset(slot_index, 0xFF, sizeof(slot_index));
+
+  uint16_t colors = 0;
+  uint16_t last_color = 0;
+  uint8_t last_index = 0;
+  for (int16_t row = 0; row < TFT_HEIGHT; row++)
+  {
+    for (int16_t col = 0; col < TFT_WIDTH; col++)
     {
+      uint16_t color = image[row][col];
+      if (color != last_color || colors == 0)
+      {
+        uint16_t slot = (color * 40503U) >> 7 & (slots - 1);
+        while (slot_index[slot] != 0xFFFF && slot_color[slot] != color)
+          slot = (slot + 1) & (slots - 1);
+        if (slot_index[slot] == 0xFFFF)
+        {
+          if (colors == 256)
+            return false;
+          slot_color[slot] = color;
+          slot_index[slot] = colors;
+          glyph->palette[colors++] = color;
+        }
+        last_color = color;
+        last_index = slot_index[slot];
+      }
+      glyph->pixels[row][col] = last_index;
+    }
+  }
+  glyph->colors = colors;
+  return true;
+}
+
+// Turns a glyph row back into RGB565 pixels (panel byte order). "dimmed": with the current dimming, which for 8 bit
+// glyphs is a lookup in the dimmed palette, made once per brightness instead of dimming every pixel.
+void TFTs::ExpandGlyphRow(CachedGlyph *glyph, int16_t row, uint16_t *out, bool dimmed)
+{
 #ifdef DIM_WITH_ENABLE_PIN_PWM
-      // skip alpha blending for dimming if hardware dimming is used
-      UnpackedImageBuffer[row + y][col + x] = (lineBuffer[col * 2 + 1] << 8) | (lineBuffer[col * 2]);
+  dimmed = false; // the display does it
 #else
-      if (dimming == 255)
-      { // not needed, copy directly
-        UnpackedImageBuffer[row + y][col + x] = (lineBuffer[col * 2 + 1] << 8) | (lineBuffer[col * 2]);
+  dimmed = dimmed && dimming != 255;
+#endif
+  if (glyph->colors == 0)
+  {
+    if (dimmed)
+      CopyShownRow(glyph->wide[row], out);
+    else
+      memcpy(out, glyph->wide[row], TFT_WIDTH * 2);
+    return;
+  }
+
+  const uint16_t *palette = glyph->palette;
+#ifndef DIM_WITH_ENABLE_PIN_PWM
+  if (dimmed)
+  {
+    if (glyph->palette_dimming != dimming)
+    {
+      DimPixels(glyph->palette, glyph->dimmed_palette, glyph->colors);
+      glyph->palette_dimming = dimming;
+    }
+    palette = glyph->dimmed_palette;
+  }
+#endif
+  const uint8_t *pixels = glyph->pixels[row];
+  for (int16_t col = 0; col < TFT_WIDTH; col++)
+    out[col] = palette[pixels[col]];
+}
+
+// Loads one missing digit of the active clock face into a free buffer, which also puts it into the cache. Called in
+// free time only.
+void TFTs::FillGlyphCache()
+{
+  if (GlyphCache == nullptr)
+  {
+    if (GlyphCacheFace != current_graphic) // retry after a face change, memory may be available again
+    {
+      GlyphCacheFace = current_graphic;
+      AllocateGlyphCache();
+    }
+    return;
+  }
+  if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) < GLYPH_CACHE_MIN_FREE_PSRAM)
+  {
+    ReleaseGlyphCache();
+    return;
+  }
+
+  // Digits of the next second first, then the rest of the face.
+  for (uint8_t i = 0; i < PrefetchCount + 10; i++)
+  {
+    uint8_t file_index = i < PrefetchCount ? PrefetchFiles[i] : current_graphic * 10 + (i - PrefetchCount);
+    CachedGlyph *glyph = GlyphCacheEntry(file_index);
+    if (glyph == nullptr)
+      return;
+    uint8_t value = file_index % 10;
+    if ((GlyphCacheValid | GlyphCacheFailed) & (1 << value))
+      continue;
+
+    int8_t buffer = FindImageBuffer(file_index);
+    if (buffer >= 0)
+    { // already decoded
+      StoreInGlyphCache(file_index, buffer);
+      continue;
+    }
+    buffer = FindPrefetchBuffer();
+    if (buffer >= 0)
+      LoadImageIntoBuffer(file_index, buffer);
+    return; // one image per call
+  }
+}
+#endif // GLYPH_CACHE
+
+#ifdef DIGIT_TRANSITION
+static_assert(DIGIT_TRANSITION_MS < 800, "a digit transition must be over before the next second");
+
+// Starts animating a digit change. Returns false if the digit has to be drawn at once: transitions off, a digit not in
+// the glyph cache, or the displays are too slow for at least two frames in time.
+bool TFTs::StartTransition(uint8_t digit, uint8_t from, uint8_t to)
+{
+  if (transition == instant || GlyphCache == nullptr)
+    return false;
+  if (to != blanked && TransitionGlyph(to) == nullptr)
+    PrepareImage(current_graphic * 10 + to); // puts it into the glyph cache as well
+  if ((from != blanked && TransitionGlyph(from) == nullptr) || (to != blanked && TransitionGlyph(to) == nullptr))
+    return false;
+
+  // Frames are planned for full screens on all displays in transition, with the measured speed of this board.
+  uint8_t running = 1;
+  for (uint8_t i = 0; i < NUM_DIGITS; i++)
+    running += (i != digit && Transitions[i].active);
+  uint32_t frame_us = uint32_t((uint64_t(PixelTimeNs) * TFT_WIDTH * TFT_HEIGHT * running) / 1000);
+  uint32_t frames = (DIGIT_TRANSITION_MS * 1000UL) / (frame_us + 1);
+  if (frames < 2)
+    return false;
+
+  // A transition still running on this display just goes on from the rows it has drawn, the row hashes know them.
+  Transition &t = Transitions[digit];
+  t.from = from;
+  t.to = to;
+  t.frames = min<uint32_t>(frames, DIGIT_TRANSITION_MAX_FRAMES);
+  t.frame = 0;
+  t.start = millis();
+  t.active = true;
+  return true;
+}
+
+TFTs::CachedGlyph *TFTs::TransitionGlyph(uint8_t value)
+{
+  if (value == blanked)
+    return nullptr;
+  CachedGlyph *glyph = GlyphCacheEntry(current_graphic * 10 + value);
+  if (glyph == nullptr || !(GlyphCacheValid & (1 << value)))
+    return nullptr;
+  return glyph;
+}
+
+void TFTs::RenderTransitions()
+{
+  uint32_t loop_start = millis();
+  uint8_t first = NextTransitionDigit;
+  for (uint8_t n = 0; n < NUM_DIGITS; n++)
+  {
+    uint8_t digit = (first + n) % NUM_DIGITS;
+    Transition &t = Transitions[digit];
+    if (!t.active)
+      continue;
+    if (!TFTsEnabled)
+    {
+      t.active = false; // displays are off, the digit is drawn completely when they are on again
+      continue;
+    }
+
+    // Frames are due by time. A late frame skips the ones in between, the last one is due at the end of the transition.
+    uint32_t elapsed = millis() - t.start;
+    uint8_t frame = elapsed >= DIGIT_TRANSITION_MS ? t.frames : min<uint32_t>(elapsed * t.frames / DIGIT_TRANSITION_MS + 1, t.frames);
+    if (frame <= t.frame)
+      continue;
+    if (millis() - loop_start >= DIGIT_TRANSITION_LOOP_BUDGET_MS && frame < t.frames)
+    {
+      NextTransitionDigit = digit; // out of time for this loop, this display is first in the next one
+      return;
+    }
+    RenderTransitionFrame(digit, frame);
+    NextTransitionDigit = (digit + 1) % NUM_DIGITS;
+  }
+}
+
+void TFTs::RenderTransitionFrame(uint8_t digit, uint8_t frame)
+{
+  Transition &t = Transitions[digit];
+  CachedGlyph *from = TransitionGlyph(t.from);
+  CachedGlyph *to = TransitionGlyph(t.to);
+  if ((t.from != blanked && from == nullptr) || (t.to != blanked && to == nullptr))
+  { // cache emptied meanwhile (face changed, low on PSRAM): just show the new digit
+    showDigit(digit);
+    return;
+  }
+
+  uint32_t StartTime = micros();
+  uint32_t pixels = 0;
+  uint16_t progress = frame * 256 / t.frames; // 0..256
+  WaitForImageTransfer();
+  chip_select.setDigit(digit);
+  bool oldSwapBytes = getSwapBytes();
+  setSwapBytes(false); // glyphs are in panel byte order
+
+  // Rows the display already shows are skipped, the others are put together in stripes of consecutive rows.
+  // The status overlay stays in place over the animation.
+  const Overlay *overlay = GetOverlay(1 << digit);
+  uint16_t(*stripe)[TFT_WIDTH] = GetSendStripe();
+  int16_t stripe_first = 0, stripe_rows = 0;
+  for (int16_t row = 0; row <= TFT_HEIGHT; row++)
+  {
+    uint32_t hash = 0;
+    TransitionRow src;
+    const uint16_t *overlay_row = OverlayRow(overlay, row);
+    if (row < TFT_HEIGHT)
+    {
+      if (overlay_row != nullptr)
+        hash = ShownRowHash(overlay->row_hash[row - overlay->first_row]);
+      else
+      {
+        GetTransitionRow(t, from, to, progress, row, src);
+        hash = ShownRowHash(src.hash);
       }
+      if (hash == DisplayRowHash[digit][row])
+        continue;
+    }
+    if (stripe_rows > 0 && (row == TFT_HEIGHT || stripe_first + stripe_rows != row || stripe_rows == SEND_STRIPE_ROWS))
+    {
+      PushSendStripe(stripe, stripe_first, stripe_rows); // rows are dimmed already
+      pixels += stripe_rows * TFT_WIDTH;
+      stripe = GetSendStripe();
+      stripe_rows = 0;
+    }
+    if (row == TFT_HEIGHT)
+      break;
+    if (stripe_rows == 0)
+      stripe_first = row;
+    if (overlay_row != nullptr)
+      CopyShownRow(overlay_row, stripe[stripe_rows++]);
+    else
+      ComposeTransitionRow(src, stripe[stripe_rows++]);
+    DisplayRowHash[digit][row] = hash;
+  }
+  setSwapBytes(oldSwapBytes);
+  WaitForImageTransfer();
+
+  if (pixels > 0) // speed of this board, for planning the next transitions
+    PixelTimeNs = (PixelTimeNs * 3 + uint32_t((uint64_t(micros() - StartTime) * 1000) / pixels)) / 4;
+
+  t.frame = frame;
+  if (frame == t.frames)
+    t.active = false;
+#ifdef DEBUG_OUTPUT_IMAGES
+  Serial.print("Transition frame ");
+  Serial.print(frame);
+  Serial.print("/");
+  Serial.print(t.frames);
+  Serial.print(", pixels: ");
+  Serial.println(pixels);
+#endif
+}
+
+// Maps a display row of a transition frame at "progress" (0..256) to the glyph rows it shows.
+void TFTs::GetTransitionRow(const Transition &t, CachedGlyph *from, CachedGlyph *to, uint16_t progress, int16_t row, TransitionRow &src)
+{
+  CachedGlyph *glyph = nullptr;
+  int16_t glyph_row = -1;
+  src.alpha = 0;
+  src.b = nullptr;
+
+  switch (transition)
+  {
+  case crossfade:
+    src.a = from;
+    src.b = to;
+    src.row_a = src.row_b = row;
+    src.alpha = progress >> 3;
+    {
+      uint32_t hash_a = from ? from->row_hash[row] : BlackRowHash;
+      uint32_t hash_b = to ? to->row_hash[row] : BlackRowHash;
+      if (src.alpha == 0 || hash_a == hash_b)
+        src.hash = hash_a;
+      else if (src.alpha == 32)
+        src.hash = hash_b;
       else
       {
-        // 16 BPP pixel format: R5, G6, B5 ; bin: RRRR RGGG GGGB BBBB
-        PixM = lineBuffer[col * 2 + 1];
-        PixL = lineBuffer[col * 2];
-        // align to 8-bit value (MSB left aligned)
-        r = (PixM) & 0xF8;
-        g = ((PixM << 5) | (PixL >> 3)) & 0xFC;
-        b = (PixL << 3) & 0xF8;
-        r *= dimming;
-        g *= dimming;
-        b *= dimming;
-        r = r >> 8;
-        g = g >> 8;
-        b = b >> 8;
-        UnpackedImageBuffer[row + y][col + x] = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-      } // dimming
+        src.hash = (((hash_a * 16777619UL) ^ hash_b) ^ src.alpha) * 16777619UL;
+        if (src.hash == 0)
+          src.hash = 1;
+      }
+    }
+    return;
+  case slide: // the old digit moves up and out, the new one comes in from below
+  {
+    int16_t offset = (TFT_HEIGHT * progress) >> 8;
+    if (row < TFT_HEIGHT - offset)
+    {
+      glyph = from;
+      glyph_row = row + offset;
+    }
+    else
+    {
+      glyph = to;
+      glyph_row = row - (TFT_HEIGHT - offset);
+    }
+    break;
+  }
+  default: // flip: the old digit folds together to a line in the middle, the new one unfolds from there
+  {
+    int16_t scale = progress < 128 ? 256 - 2 * progress : 2 * progress - 256; // height of the digit, 0..256
+    glyph = progress < 128 ? from : to;
+    if (scale > 0)
+    {
+      glyph_row = TFT_HEIGHT / 2 + ((row - TFT_HEIGHT / 2) * 256) / scale;
+      if (glyph_row < 0 || glyph_row >= TFT_HEIGHT)
+        glyph_row = -1;
+    }
+    break;
+  }
+  }
+
+  if (glyph == nullptr || glyph_row < 0)
+  {
+    src.a = nullptr;
+    src.hash = BlackRowHash;
+  }
+  else
+  {
+    src.a = glyph;
+    src.row_a = glyph_row;
+    src.hash = glyph->row_hash[glyph_row];
+  }
+}
+
+// Puts the row together, already dimmed.
+void TFTs::ComposeTransitionRow(const TransitionRow &src, uint16_t *out)
+{
+  if (src.alpha == 0 || src.alpha == 32)
+  {
+    CachedGlyph *glyph = src.alpha == 0 ? src.a : src.b;
+    if (glyph != nullptr)
+      ExpandGlyphRow(glyph, src.alpha == 0 ? src.row_a : src.row_b, out, true);
+    else
+      memset(out, 0, TFT_WIDTH * 2); // black
+    return;
+  }
+
+  // RGB565 blend of two pixels: the channels are spread over 32 bit (-G-R-B) with room for a 5 bit factor.
+  // Blended undimmed, then dimmed like any other row.
+  uint16_t row_b[TFT_WIDTH];
+  if (src.a != nullptr)
+    ExpandGlyphRow(src.a, src.row_a, out, false);
+  else
+    memset(out, 0, TFT_WIDTH * 2);
+  if (src.b != nullptr)
+    ExpandGlyphRow(src.b, src.row_b, row_b, false);
+  else
+    memset(row_b, 0, TFT_WIDTH * 2);
+  uint32_t alpha = src.alpha;
+  for (int16_t col = 0; col < TFT_WIDTH; col++)
+  {
+    uint32_t a = toPanelOrder(out[col]);
+    uint32_t b = toPanelOrder(row_b[col]);
+    if (a == b)
+      continue;
+    a = (a | (a << 16)) & 0x07E0F81F;
+    b = (b | (b << 16)) & 0x07E0F81F;
+    uint32_t c = ((a * (32 - alpha) + b * alpha) >> 5) & 0x07E0F81F;
+    out[col] = toPanelOrder(uint16_t(c | (c >> 16)));
+  }
+#ifndef DIM_WITH_ENABLE_PIN_PWM
+  if (dimming != 255)
+    DimPixels(out, out, TFT_WIDTH);
 #endif
-    } // col
-  } // row
-  FileInBuffer = file_index;
+}
+
+void TFTs::FinishTransitions()
+{
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    if (Transitions[digit].active && TFTsEnabled)
+      RenderTransitionFrame(digit, Transitions[digit].frames);
+    Transitions[digit].active = false;
+  }
+}
+#else
+void TFTs::RenderTransitions() {}
+void TFTs::FinishTransitions() {}
+#endif // DIGIT_TRANSITION
+
+#ifndef TFT_BAND_ROWS
+int8_t TFTs::FindImageBuffer(uint8_t file_index)
+{
+  for (uint8_t i = 0; i < NumberOfImageBuffers; i++)
+  {
+    if (FileInBuffer[i] == file_index)
+      return i;
+  }
+  return -1;
+}
+
+uint8_t TFTs::FindFreeImageBuffer()
+{
+  // Prefer a buffer that is neither being sent nor holding a prefetched image (its digit may still be drawn in this update)
+  // nor the last drawn image (it might be needed again for the next digit).
+  int8_t best = -1;
+  uint8_t best_score = 0;
+  for (uint8_t i = 0; i < NumberOfImageBuffers; i++)
+  {
+    if (i == BufferInTransfer)
+      continue;
+    uint8_t score = 1 + (IsPrefetched(FileInBuffer[i]) ? 0 : 2) + (i == LastDrawnBuffer ? 0 : 1);
+    if (score > best_score)
+    {
+      best = i;
+      best_score = score;
+    }
+  }
+  if (best >= 0)
+    return best;
+  // Single buffer which is still on the wire: it can only be overwritten after the transfer is done.
+  WaitForImageTransfer();
+  return 0;
+}
+
+// A buffer for prefetching: one that holds no image of the next second. -1 if there is none.
+int8_t TFTs::FindPrefetchBuffer()
+{
+  int8_t sending = -1;
+  for (uint8_t i = 0; i < NumberOfImageBuffers; i++)
+  {
+    if (IsPrefetched(FileInBuffer[i]))
+      continue;
+    if (i != BufferInTransfer)
+      return i;
+    sending = i;
+  }
+  if (sending >= 0)
+    WaitForImageTransfer(); // the last digit drawn, its transfer is long done in free time
+  return sending;
+}
 
-  bmpFS.close();
+// Returns the buffer holding the requested image, loading it first if needed.
+uint8_t TFTs::PrepareImage(uint8_t file_index)
+{
+  int8_t buffer = FindImageBuffer(file_index);
+  // check if file is already loaded into buffer; skip loading if it is. Saves 50 to 150 msec of time.
+  if (buffer < 0)
+  {
 #ifdef DEBUG_OUTPUT_IMAGES
-  Serial.print("img load time: ");
-  Serial.println(millis() - StartTime);
+    Serial.println("Not preloaded; loading now...");
 #endif
-  return (true);
+    buffer = FindFreeImageBuffer();
+    LoadImageIntoBuffer(file_index, buffer);
+  }
+  return buffer;
 }
+
+// Image buffers beyond the static one, in DMA capable internal RAM if DMA is used: the second one for DMA in begin(),
+// then, after EnablePrefetchBuffers(), the prefetch buffers as long as IMAGE_PREFETCH_MIN_FREE_HEAP stays free.
+void TFTs::AllocateImageBuffers()
+{
+  uint32_t caps = (DMAEnabled ? MALLOC_CAP_DMA : MALLOC_CAP_INTERNAL) | MALLOC_CAP_8BIT;
+  NumberOfFixedBuffers = DMAEnabled ? 2 : 1;
+  uint8_t wanted = NumberOfFixedBuffers + (PrefetchBuffersEnabled ? IMAGE_PREFETCH_BUFFERS : 0);
+  while (NumberOfImageBuffers < wanted)
+  {
+    bool for_dma = NumberOfImageBuffers < NumberOfFixedBuffers;
+    if (!for_dma && (heap_caps_get_free_size(caps) < sizeof(UnpackedImageBuffer) + IMAGE_PREFETCH_MIN_FREE_HEAP ||
+                     heap_caps_get_largest_free_block(caps) < sizeof(UnpackedImageBuffer)))
+      break;
+    void *buffer = heap_caps_malloc(sizeof(UnpackedImageBuffer), caps);
+    if (buffer == nullptr)
+      break;
+    FileInBuffer[NumberOfImageBuffers] = 255;
+    ImageBuffer[NumberOfImageBuffers++] = reinterpret_cast<uint16_t(*)[TFT_WIDTH]>(buffer);
+  }
+  Serial.print("Image buffers: ");
+  Serial.println(NumberOfImageBuffers);
+}
+
+void TFTs::EnablePrefetchBuffers()
+{
+#ifndef GLYPH_CACHE // the digits of the next second come from the glyph cache
+  if (PrefetchBuffersEnabled)
+    return;
+  PrefetchBuffersEnabled = true;
+  AllocateImageBuffers();
 #endif
+}
 
-void TFTs::DrawImage(uint8_t file_index)
+// Gives the last prefetch buffer back to the heap. Not allocated again, the RAM is obviously needed elsewhere.
+void TFTs::ReleasePrefetchBuffer()
+{
+  uint8_t buffer = NumberOfImageBuffers - 1;
+  if (buffer == BufferInTransfer)
+    WaitForImageTransfer();
+  if (LastDrawnBuffer == buffer)
+    LastDrawnBuffer = 0;
+  heap_caps_free(ImageBuffer[buffer]);
+  ImageBuffer[buffer] = nullptr;
+  FileInBuffer[buffer] = 255;
+  NumberOfImageBuffers--;
+  Serial.print("Low on RAM, image buffers: ");
+  Serial.println(NumberOfImageBuffers);
+}
+
+void TFTs::DrawImage(uint8_t digit_map, uint8_t buffer)
 {
 
   uint32_t StartTime = millis();
 #ifdef DEBUG_OUTPUT_IMAGES
   Serial.println("");
   Serial.print("Drawing image: ");
-  Serial.println(file_index);
+  Serial.println(FileInBuffer[buffer]);
 #endif
-  // check if file is already loaded into buffer; skip loading if it is. Saves 50 to 150 msec of time.
-  if (file_index != FileInBuffer)
-  {
+  LastDrawnBuffer = buffer;
+  uint16_t RowsSent = SendRows(digit_map, buffer, GetOverlay(digit_map), 0, TFT_HEIGHT);
+  (void)RowsSent; // only printed with DEBUG_OUTPUT_IMAGES
+
 #ifdef DEBUG_OUTPUT_IMAGES
-    Serial.println("Not preloaded; loading now...");
+  Serial.print("rows sent: ");
+  Serial.println(RowsSent);
+  Serial.print("img transfer time: ");
+  Serial.println(millis() - StartTime);
 #endif
-    LoadImageIntoBuffer(file_index);
-  }
+}
+
+#else
+// Opens the image and sends it to the display band by band while it is decoded. Rows the image doesn't cover are black.
+bool TFTs::DrawImageBands(uint8_t digit_map, uint8_t file_index)
+{
+  uint32_t StartTime = millis();
+  ImageFile img;
+  if (!OpenImageFile(file_index, img))
+    return (false);
 
   bool oldSwapBytes = getSwapBytes();
-  setSwapBytes(true);
-  pushImage(0, 0, TFT_WIDTH, TFT_HEIGHT, reinterpret_cast<uint16_t *>(UnpackedImageBuffer));
+  setSwapBytes(false); // decoded pixels are already in panel byte order
+  BandDigits = digit_map;
+  BandOverlay = GetOverlay(digit_map);
+  StartBand(BAND_DIRECTION > 0 ? 0 : (TFT_HEIGHT - 1) / TFT_BAND_ROWS * TFT_BAND_ROWS);
+  bool decoded = DecodeImageData(img, nullptr);
+  while (BandFirstRow >= 0) // the bands after the last image row
+    SendBand();
   setSwapBytes(oldSwapBytes);
 
+  if (!PackFile)
+    img.file.close(); // the pack stays open
 #ifdef DEBUG_OUTPUT_IMAGES
-  Serial.print("img transfer time: ");
+  Serial.print("img load and transfer time: ");
   Serial.println(millis() - StartTime);
 #endif
+  return decoded;
+}
+
+// Starts decoding a band into the stripe that is not on the wire: of the two stripes, only the one pushed last can be.
+void TFTs::StartBand(int16_t first_row)
+{
+  BandFirstRow = first_row;
+  memset(SendStripe[NextSendStripe], 0, sizeof(SendStripe[NextSendStripe])); // black background
+}
+
+// Where the decoder writes a display row. Bands the decoder has left are sent first.
+uint16_t *TFTs::BandRow(int16_t row)
+{
+  while (BandFirstRow >= 0 && (row < BandFirstRow || row >= BandFirstRow + TFT_BAND_ROWS))
+    SendBand();
+  return SendStripe[NextSendStripe][row - BandFirstRow];
+}
+
+// Sends the rows of the band that differ from the display and starts the next band in decoding order.
+void TFTs::SendBand()
+{
+  uint16_t(*band)[TFT_WIDTH] = SendStripe[NextSendStripe];
+  int16_t rows = min<int16_t>(TFT_BAND_ROWS, TFT_HEIGHT - BandFirstRow);
+  bool pushed = false;
+
+  for (int16_t row = 0; row < rows; row++)
+  {
+    const uint16_t *overlay_row = OverlayRow(BandOverlay, BandFirstRow + row);
+    if (overlay_row != nullptr)
+      memcpy(band[row], overlay_row, TFT_WIDTH * 2);
+  }
+
+  int16_t row = 0;
+  while (row < rows)
+  {
+    uint32_t hash = ShownRowHash(HashRow(band[row]));
+    if (IsRowShown(BandDigits, BandFirstRow + row, hash))
+    {
+      row++;
+      continue;
+    }
+    int16_t first_row = row;
+    while (row < rows && !IsRowShown(BandDigits, BandFirstRow + row, hash))
+    {
+      SetRowShown(BandDigits, BandFirstRow + row, hash);
+      if (++row < rows)
+        hash = ShownRowHash(HashRow(band[row]));
+    }
+#ifndef DIM_WITH_ENABLE_PIN_PWM
+    if (dimming != 255)
+      DimPixels(band[first_row], band[first_row], (row - first_row) * TFT_WIDTH); // in place, the band is not needed undimmed
+#endif
+    PushSendStripe(band + first_row, BandFirstRow + first_row, row - first_row);
+    pushed = true;
+  }
+  if (pushed)
+    NextSendStripe ^= 1;
+
+  int16_t next_row = BandFirstRow + BAND_DIRECTION * TFT_BAND_ROWS;
+  if (next_row >= 0 && next_row < TFT_HEIGHT)
+    StartBand(next_row);
+  else
+    BandFirstRow = -1;
+}
+#endif // TFT_BAND_ROWS
+
+// Sends the rows from "first" to "end" that differ from what the displays of the map show: from the overlay where
+// there is one, else from the image buffer, or black if "buffer" is -1. Returns the number of rows sent.
+uint16_t TFTs::SendRows(uint8_t digit_map, int8_t buffer, const Overlay *overlay, int16_t first, int16_t end)
+{
+  uint16_t rows_sent = 0;
+  bool oldSwapBytes = getSwapBytes();
+  setSwapBytes(false); // buffers and overlays are already in panel byte order
+
+  // Send only the row spans that differ from what the displays already show (black borders, common parts of glyphs).
+  int16_t row = first;
+  while (row < end)
+  {
+    uint32_t hash = SourceRowHash(buffer, overlay, row);
+    if (IsRowShown(digit_map, row, hash))
+    {
+      row++;
+      continue;
+    }
+    int16_t first_row = row;
+    const uint16_t *overlay_row = OverlayRow(overlay, first_row);
+    while (row < end && !IsRowShown(digit_map, row, hash))
+    {
+      SetRowShown(digit_map, row, hash);
+      if (++row < end)
+        hash = SourceRowHash(buffer, overlay, row);
+      if ((OverlayRow(overlay, row) == nullptr) != (overlay_row == nullptr))
+        break; // the span goes on from the overlay or from the image
+    }
+    if (overlay_row != nullptr)
+      PushImageRows(overlay->pixels + (first_row - overlay->first_row), first_row, row - first_row, MAX_IMAGE_BUFFERS);
+#ifndef TFT_BAND_ROWS
+    else if (buffer >= 0)
+      PushImageRows(ImageBuffer[buffer] + first_row, first_row, row - first_row, buffer);
+#endif
+    else
+    {
+      WaitForImageTransfer(); // fillRect() doesn't wait for DMA
+      fillRect(0, first_row, TFT_WIDTH, row - first_row, TFT_BLACK);
+    }
+    rows_sent += row - first_row;
+  }
+  setSwapBytes(oldSwapBytes);
+  return rows_sent;
+}
+
+// Hash of a row as the image, black or the overlay puts it on the display.
+uint32_t TFTs::SourceRowHash(int8_t buffer, const Overlay *overlay, int16_t row)
+{
+  if (OverlayRow(overlay, row) != nullptr)
+    return ShownRowHash(overlay->row_hash[row - overlay->first_row]);
+#ifndef TFT_BAND_ROWS
+  if (buffer >= 0)
+    return ShownRowHash(ImageRowHash[buffer][row]);
+#endif
+  return BlackRowHash;
+}
+
+// Sends rows from "pixels" (the first of them), which are in image buffer "buffer", or MAX_IMAGE_BUFFERS if elsewhere.
+void TFTs::PushImageRows(uint16_t (*pixels)[TFT_WIDTH], int16_t first_row, int16_t rows, uint8_t buffer)
+{
+#ifndef DIM_WITH_ENABLE_PIN_PWM
+  if (dimming != 255)
+  {
+    for (int16_t stripe_row = 0; stripe_row < rows; stripe_row += SEND_STRIPE_ROWS)
+    {
+      int16_t stripe_rows = min<int16_t>(SEND_STRIPE_ROWS, rows - stripe_row);
+      uint16_t(*stripe)[TFT_WIDTH] = GetSendStripe();
+      DimPixels(pixels[stripe_row], stripe[0], stripe_rows * TFT_WIDTH);
+      PushSendStripe(stripe, first_row + stripe_row, stripe_rows);
+    }
+    return;
+  }
+#endif
+#ifdef TFT_USE_DMA
+  if (DMAEnabled)
+  {
+    if (BufferInTransfer < 0)
+      startWrite(); // keep the SPI bus until WaitForImageTransfer()
+    pushImageDMA(0, first_row, TFT_WIDTH, rows, pixels[0]); // waits for the previous span itself
+    BufferInTransfer = buffer;
+    return;
+  }
+#endif
+  pushImage(0, first_row, TFT_WIDTH, rows, pixels[0]);
+}
+#if !defined(DIM_WITH_ENABLE_PIN_PWM) || defined(DIGIT_TRANSITION) || defined(TFT_BAND_ROWS)
+// The stripe returned is free to be filled: pushImageDMA() waits for the previous transfer, so of the two stripes
+// only the one pushed last can still be on the wire.
+uint16_t (*TFTs::GetSendStripe())[TFT_WIDTH]
+{
+  uint16_t(*stripe)[TFT_WIDTH] = SendStripe[NextSendStripe];
+  NextSendStripe ^= 1;
+  return stripe;
+}
+
+void TFTs::PushSendStripe(uint16_t (*stripe)[TFT_WIDTH], int16_t first_row, int16_t rows)
+{
+#ifdef TFT_USE_DMA
+  if (DMAEnabled)
+  {
+    if (BufferInTransfer < 0)
+      startWrite(); // keep the SPI bus until WaitForImageTransfer()
+    pushImageDMA(0, first_row, TFT_WIDTH, rows, stripe[0]);
+    BufferInTransfer = MAX_IMAGE_BUFFERS; // a stripe, not an image buffer
+    return;
+  }
+#endif
+  pushImage(0, first_row, TFT_WIDTH, rows, stripe[0]);
+}
+#endif
+
+// FNV-1a over the pixels of one row. Never returns 0, which marks an unknown row.
+uint32_t TFTs::HashRow(const uint16_t *row)
+{
+  uint32_t hash = 2166136261UL;
+  for (int16_t col = 0; col < TFT_WIDTH; col++)
+  {
+    hash = (hash ^ row[col]) * 16777619UL;
+  }
+  return hash ? hash : 1;
+}
+
+#ifndef TFT_BAND_ROWS
+void TFTs::HashImageRows(uint8_t buffer)
+{
+  for (int16_t row = 0; row < TFT_HEIGHT; row++)
+    ImageRowHash[buffer][row] = HashRow(ImageBuffer[buffer][row]);
+}
+#endif
+
+// True if all displays of the map show this row already. A hash of 0 is unknown and never shown.
+bool TFTs::IsRowShown(uint8_t digit_map, int16_t row, uint32_t hash)
+{
+  if (hash == 0)
+    return false;
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    if ((digit_map & (1 << digit)) && DisplayRowHash[digit][row] != hash)
+      return false;
+  }
+  return true;
 }
 
-// These read 16- and 32-bit types from the SD card file.
-// BMP data is stored little-endian, Arduino is little-endian too.
-// May need to reverse subscript order if porting elsewhere.
+void TFTs::SetRowShown(uint8_t digit_map, int16_t row, uint32_t hash)
+{
+  for (uint8_t digit = 0; digit < NUM_DIGITS; digit++)
+  {
+    if (digit_map & (1 << digit))
+      DisplayRowHash[digit][row] = hash;
+  }
+}
 
-uint16_t TFTs::read16(fs::File &f)
+void TFTs::InvalidateDisplayRows(uint8_t digit, int16_t first_row, int16_t rows)
 {
-  uint16_t result;
-  reinterpret_cast<uint8_t *>(&result)[0] = f.read(); // LSB
-  reinterpret_cast<uint8_t *>(&result)[1] = f.read(); // MSB
-  return result;
+  for (int16_t row = first_row; row < first_row + rows && row < TFT_HEIGHT; row++)
+    DisplayRowHash[digit][row] = 0;
 }
 
-uint32_t TFTs::read32(fs::File &f)
+bool TFTs::IsDisplayBlack(uint8_t digit)
 {
-  uint32_t result;
-  reinterpret_cast<uint8_t *>(&result)[0] = f.read(); // LSB
-  reinterpret_cast<uint8_t *>(&result)[1] = f.read();
-  reinterpret_cast<uint8_t *>(&result)[2] = f.read();
-  reinterpret_cast<uint8_t *>(&result)[3] = f.read(); // MSB
-  return result;
+  for (int16_t row = 0; row < TFT_HEIGHT; row++)
+  {
+    if (DisplayRowHash[digit][row] != BlackRowHash || BlackRowHash == 0)
+      return false;
+  }
+  return true;
+}
+
+void TFTs::SetDisplayBlack(uint8_t digit)
+{
+  if (BlackRowHash == 0)
+  {
+    uint16_t black[TFT_WIDTH] = {0};
+    BlackRowHash = HashRow(black);
+  }
+  for (int16_t row = 0; row < TFT_HEIGHT; row++)
+    DisplayRowHash[digit][row] = BlackRowHash;
 }
 
 String TFTs::clockFaceToName(uint8_t clockFace)
@@ -644,7 +2000,7 @@ String TFTs::clockFaceToName(uint8_t clockFace)
 
 uint8_t TFTs::nameToClockFace(String name)
 {
-  for (int i = 0; i < 9; i++)
+  for (int i = 0; i < MAX_CLOCK_FACES; i++)
   {
     if (patterns_str[i] == name)
     {
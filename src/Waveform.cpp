@@ -0,0 +1,78 @@
+#include "Waveform.h"
+
+// round(255 * sin(pi / 2 * i / 256)), i = 0..256: a quarter turn of the sine.
+const uint8_t Waveform::quarter_sine[257] = {
+    0, 2, 3, 5, 6, 8, 9, 11, 13, 14, 16, 17, 19, 20, 22, 23,
+    25, 27, 28, 30, 31, 33, 34, 36, 37, 39, 41, 42, 44, 45, 47, 48,
+    50, 51, 53, 54, 56, 57, 59, 60, 62, 63, 65, 67, 68, 70, 71, 73,
+    74, 76, 77, 79, 80, 81, 83, 84, 86, 87, 89, 90, 92, 93, 95, 96,
+    98, 99, 100, 102, 103, 105, 106, 108, 109, 110, 112, 113, 115, 116, 117, 119,
+    120, 122, 123, 124, 126, 127, 128, 130, 131, 132, 134, 135, 136, 138, 139, 140,
+    142, 143, 144, 146, 147, 148, 149, 151, 152, 153, 154, 156, 157, 158, 159, 161,
+    162, 163, 164, 165, 167, 168, 169, 170, 171, 172, 174, 175, 176, 177, 178, 179,
+    180, 181, 183, 184, 185, 186, 187, 188, 189, 190, 191, 192, 193, 194, 195, 196,
+    197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207, 208, 208, 209, 210, 211,
+    212, 213, 214, 215, 215, 216, 217, 218, 219, 220, 220, 221, 222, 223, 223, 224,
+    225, 226, 226, 227, 228, 228, 229, 230, 231, 231, 232, 232, 233, 234, 234, 235,
+    236, 236, 237, 237, 238, 238, 239, 240, 240, 241, 241, 242, 242, 243, 243, 244,
+    244, 244, 245, 245, 246, 246, 247, 247, 247, 248, 248, 248, 249, 249, 249, 250,
+    250, 250, 251, 251, 251, 252, 252, 252, 252, 252, 253, 253, 253, 253, 253, 254,
+    254, 254, 254, 254, 254, 254, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255,
+};
+
+// round((exp(sin(2 * pi * i / 256)) - 1 / e) * 108), i = 0..256: a whole turn.
+// https://sean.voisen.org/blog/2011/10/breathing-led-with-arduino/
+const uint8_t Waveform::breath_curve[257] = {
+    68, 71, 74, 77, 79, 82, 85, 88, 92, 95, 98, 101, 105, 108, 112, 115,
+    119, 122, 126, 130, 133, 137, 141, 145, 149, 152, 156, 160, 164, 168, 172, 175,
+    179, 183, 187, 191, 194, 198, 201, 205, 208, 212, 215, 218, 221, 224, 227, 230,
+    232, 235, 237, 239, 241, 243, 245, 247, 248, 250, 251, 252, 252, 253, 253, 254,
+    254, 254, 253, 253, 252, 252, 251, 250, 248, 247, 245, 243, 241, 239, 237, 235,
+    232, 230, 227, 224, 221, 218, 215, 212, 208, 205, 201, 198, 194, 191, 187, 183,
+    179, 175, 172, 168, 164, 160, 156, 152, 149, 145, 141, 137, 133, 130, 126, 122,
+    119, 115, 112, 108, 105, 101, 98, 95, 92, 88, 85, 82, 79, 77, 74, 71,
+    68, 66, 63, 61, 58, 56, 54, 51, 49, 47, 45, 43, 41, 39, 37, 36,
+    34, 32, 31, 29, 28, 26, 25, 24, 22, 21, 20, 19, 18, 16, 15, 14,
+    14, 13, 12, 11, 10, 9, 9, 8, 7, 7, 6, 6, 5, 4, 4, 4,
+    3, 3, 2, 2, 2, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 2, 2, 2, 3,
+    3, 4, 4, 4, 5, 6, 6, 7, 7, 8, 9, 9, 10, 11, 12, 13,
+    14, 14, 15, 16, 18, 19, 20, 21, 22, 24, 25, 26, 28, 29, 31, 32,
+    34, 36, 37, 39, 41, 43, 45, 47, 49, 51, 54, 56, 58, 61, 63, 66,
+    68,
+};
+
+// round(65535 * (i / 255)^2.2), i = 0..255: the light of the LED for a colour value.
+const uint16_t Waveform::gamma_curve[256] = {
+    0, 0, 2, 4, 7, 11, 17, 24, 32, 42, 53, 65, 79, 94, 111, 129,
+    148, 169, 192, 216, 242, 270, 299, 330, 362, 396, 432, 469, 508, 549, 591, 635,
+    681, 729, 779, 830, 883, 938, 995, 1053, 1113, 1175, 1239, 1305, 1373, 1443, 1514, 1587,
+    1663, 1740, 1819, 1900, 1983, 2068, 2155, 2243, 2334, 2427, 2521, 2618, 2717, 2817, 2920, 3024,
+    3131, 3240, 3350, 3463, 3578, 3694, 3813, 3934, 4057, 4182, 4309, 4438, 4570, 4703, 4838, 4976,
+    5115, 5257, 5401, 5547, 5695, 5845, 5998, 6152, 6309, 6468, 6629, 6792, 6957, 7124, 7294, 7466,
+    7640, 7816, 7994, 8175, 8358, 8543, 8730, 8919, 9111, 9305, 9501, 9699, 9900, 10102, 10307, 10515,
+    10724, 10936, 11150, 11366, 11585, 11806, 12029, 12254, 12482, 12712, 12944, 13179, 13416, 13655, 13896, 14140,
+    14386, 14635, 14885, 15138, 15394, 15652, 15912, 16174, 16439, 16706, 16975, 17247, 17521, 17798, 18077, 18358,
+    18642, 18928, 19216, 19507, 19800, 20095, 20393, 20694, 20996, 21301, 21609, 21919, 22231, 22546, 22863, 23182,
+    23504, 23829, 24156, 24485, 24817, 25151, 25487, 25826, 26168, 26512, 26858, 27207, 27558, 27912, 28268, 28627,
+    28988, 29351, 29717, 30086, 30457, 30830, 31206, 31585, 31966, 32349, 32735, 33124, 33514, 33908, 34304, 34702,
+    35103, 35507, 35913, 36321, 36732, 37146, 37562, 37981, 38402, 38825, 39252, 39680, 40112, 40546, 40982, 41421,
+    41862, 42306, 42753, 43202, 43654, 44108, 44565, 45025, 45487, 45951, 46418, 46888, 47360, 47835, 48313, 48793,
+    49275, 49761, 50249, 50739, 51232, 51728, 52226, 52727, 53230, 53736, 54245, 54756, 55270, 55787, 56306, 56828,
+    57352, 57879, 58409, 58941, 59476, 60014, 60554, 61097, 61642, 62190, 62741, 63295, 63851, 64410, 64971, 65535,
+};
+
+uint8_t Waveform::absSine(uint32_t phase)
+{
+  // 16 bits within the quarter, mirrored in the second and fourth quarter.
+  uint16_t position = phase >> 14;
+  if (phase & 0x40000000)
+    position = 0xFFFF - position;
+  return interpolate(quarter_sine, position >> 8, position);
+}
+
+uint8_t Waveform::breath(uint32_t phase)
+{
+  return interpolate(breath_curve, phase >> 24, phase >> 16);
+}
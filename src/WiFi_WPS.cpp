@@ -112,7 +112,7 @@ void WiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
   }
 }
 
-void WifiBegin()
+void WifiBegin(bool wait)
 {
   WifiState = disconnected;
 
@@ -134,14 +134,22 @@ void WifiBegin()
   {
     // Data is saved, connect now.
     // WiFi credentials are known, connect.
-    tfts.println("Joining WiFi");
-    tfts.println(stored_config.config.wifi.ssid);
+    if (wait)
+    {
+      tfts.println("Joining WiFi");
+      tfts.println(stored_config.config.wifi.ssid);
+    }
     Serial.print("Joining WiFi ");
     Serial.println(stored_config.config.wifi.ssid);
 
     // https://stackoverflow.com/questions/48024780/esp32-wps-reconnect-on-power-on
     WiFi.begin(); // Use internally-saved data
     WiFi.onEvent(WiFiEvent);
+    if (!wait)
+    {
+      TimeOfWifiReconnectAttempt = millis(); // WifiReconnect() tries again after WIFI_RETRY_CONNECTION_SEC
+      return;
+    }
 
     unsigned long StartTime = millis();
 
@@ -162,6 +170,11 @@ void WifiBegin()
 #else // NO WPS -- Try using hardcoded credentials.
   WiFi.begin(WIFI_SSID, WIFI_PASSWD);
   WiFi.onEvent(WiFiEvent);
+  if (!wait)
+  {
+    TimeOfWifiReconnectAttempt = millis(); // WifiReconnect() tries again after WIFI_RETRY_CONNECTION_SEC
+    return;
+  }
   unsigned long StartTime = millis();
   while ((WiFi.status() != WL_CONNECTED))
   {
@@ -13,6 +13,7 @@
 #include "Backlights.h"
 #include "Buttons.h"
 #include "Clock.h"
+#include "LoopProfiler.h"
 #include "Menu.h"
 #include "StoredConfig.h"
 #include "TFTs.h"
@@ -146,6 +147,7 @@ TFTs tfts;
 Clock uclock;
 Menu menu;
 StoredConfig stored_config;
+LoopProfiler loop_profiler;
 
 #ifdef GEOLOCATION_ENABLED
 double GeoLocTZoffset = 0;
@@ -167,10 +169,16 @@ uint8_t hour_old = 255;
 #endif
 
 uint32_t lastMQTTCommandExecuted = (uint32_t)-1;
+#if defined(MQTT_PLAIN_ENABLED) || defined(MQTT_HOME_ASSISTANT)
+bool MQTTStarted = false; // MQTTStart() was called, in setup() or with FAST_BOOT once WiFi is connected
+#endif
 
 // Helper function, defined below.
 void updateClockDisplay(TFTs::show_t show = TFTs::yes);
-void setupMenu(void);
+void checkBootProgress(void);
+#ifdef LOOP_PROFILER
+void checkSerialCommands(void);
+#endif
 #ifdef DIMMING
 bool isNightTime(uint8_t current_hour);
 void checkDimmingNeeded(void);
@@ -182,7 +190,13 @@ void checkDimmingNeeded(void);
 void setup()
 {
   Serial.begin(115200);
+#ifdef FAST_BOOT
+  // Show the RTC time first. WiFi connects meanwhile, NTP, MQTT and geolocation follow in loop(), see checkBootProgress().
+  bool fast_boot = true;
+#else
   delay(1500); // Wait for serial monitor to catch up
+  bool fast_boot = false;
+#endif
 
   Serial.println("\nSystem starting...\n");
   Serial.println("EleksTubeHAX https://github.com/aly-fly/EleksTubeHAX");
@@ -217,6 +231,7 @@ void setup()
   }
   Serial.printf("Set device name: \"%s\".\n", UniqueDeviceName);
 
+  loop_profiler.bootPhaseStart(LoopProfiler::boot_config);
   Serial.print("Init NVS flash partition usage...");
   esp_err_t ret = nvs_flash_init(); // Initialize NVS
   if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
@@ -231,88 +246,135 @@ void setup()
 
   stored_config.begin();
   stored_config.load();
+  loop_profiler.bootPhaseDone(LoopProfiler::boot_config);
 
-  backlights.begin(&stored_config.config.backlights);
+#if defined(FAST_BOOT) && defined(WIFI_USE_WPS)
+  if (stored_config.config.wifi.WPS_connected != StoredConfig::valid)
+  {
+    Serial.println("No WiFi credentials stored, normal start-up with WPS.");
+    fast_boot = false;
+  }
+#endif
+  if (fast_boot)
+  { // Connecting takes seconds. It runs in the WiFi task while the displays and the clock are started.
+    loop_profiler.bootPhaseStart(LoopProfiler::boot_wifi);
+    WifiBegin(false);
+  }
+
+  loop_profiler.bootPhaseStart(LoopProfiler::boot_peripherals);
+  backlights.begin(&stored_config.config.backlights, &uclock);
   buttons.begin();
   menu.begin();
+  loop_profiler.bootPhaseDone(LoopProfiler::boot_peripherals);
 
   // Setup the displays (TFTs) initaly and show bootup message(s).
+  loop_profiler.bootPhaseStart(LoopProfiler::boot_displays);
   tfts.begin(); // ...and count number of clock faces available...
-  tfts.fillScreen(TFT_BLACK);
-  tfts.setTextColor(TFT_WHITE, TFT_BLACK);
-  tfts.setCursor(0, 0, 2); // Font 2. 16 pixel high
-  tfts.println("Starting Setup...");
+  loop_profiler.bootPhaseDone(LoopProfiler::boot_displays);
+  if (!fast_boot)
+  {
+    tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+    tfts.setCursor(0, 0, 2); // Font 2. 16 pixel high
+    tfts.println("Starting Setup...");
+  }
 
 #ifdef HARDWARE_NOVELLIFE_CLOCK
   // Init the Gesture sensor
   tfts.setTextColor(TFT_ORANGE, TFT_BLACK);
-  tfts.print("Gest start...");
+  if (!fast_boot)
+    tfts.print("Gest start...");
   Serial.print("Gesture Sensor start...");
   GestureStart(); // TODO put into class
-  tfts.println("Done!");
+  if (!fast_boot)
+    tfts.println("Done!");
   Serial.println("Done!");
   tfts.setTextColor(TFT_WHITE, TFT_BLACK);
 #endif // #ifdef HARDWARE_NOVELLIFE_CLOCK
 
-  // Setup WiFi connection. Must be done before setting up Clock.
-  // This is done outside Clock so the network can be used for other things.
-  tfts.setTextColor(TFT_GREENYELLOW, TFT_BLACK);
-  tfts.println("WiFi start...");
-  Serial.println("WiFi start...");
-  WifiBegin();
-  tfts.setTextColor(TFT_WHITE, TFT_BLACK);
-
-  // Wait a bit (5x100ms = 0.5 sec) before querying NTP.
-  for (uint8_t ndx = 0; ndx < 5; ndx++)
+  if (!fast_boot)
   {
-    tfts.print(">");
-    delay(100);
+    // Setup WiFi connection. Must be done before setting up Clock.
+    // This is done outside Clock so the network can be used for other things.
+    tfts.setTextColor(TFT_GREENYELLOW, TFT_BLACK);
+    tfts.println("WiFi start...");
+    Serial.println("WiFi start...");
+    loop_profiler.bootPhaseStart(LoopProfiler::boot_wifi);
+    WifiBegin();
+    loop_profiler.bootPhaseDone(LoopProfiler::boot_wifi);
+    tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+
+    // Wait a bit (5x100ms = 0.5 sec) before querying NTP.
+    for (uint8_t ndx = 0; ndx < 5; ndx++)
+    {
+      tfts.print(">");
+      delay(100);
+    }
+    tfts.println("");
   }
-  tfts.println("");
 
-  // Setup the clock. It needs WiFi to be established already.
-  tfts.setTextColor(TFT_MAGENTA, TFT_BLACK);
-  tfts.print("Clock start...");
+  // Setup the clock. Without WiFi yet (FAST_BOOT), it starts with the RTC time and NTP follows in checkBootProgress().
+  if (!fast_boot)
+  {
+    tfts.setTextColor(TFT_MAGENTA, TFT_BLACK);
+    tfts.print("Clock start...");
+    loop_profiler.bootPhaseStart(LoopProfiler::boot_ntp); // the first sync is done in uclock.begin()
+  }
   Serial.println("\nClock start-up...");
-  uclock.begin(&stored_config.config.uclock);
-  tfts.println("Done!");
+  loop_profiler.bootPhaseStart(LoopProfiler::boot_clock);
+  uclock.begin(&stored_config.config.uclock, &stored_config.config.rtc);
+  loop_profiler.bootPhaseDone(LoopProfiler::boot_clock);
   Serial.println("\nClock start-up done!");
-  tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+  if (!fast_boot)
+  {
+    tfts.println("Done!");
+    tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+  }
 
 #if defined(MQTT_PLAIN_ENABLED) || defined(MQTT_HOME_ASSISTANT)
-  // Setup MQTT.
-  tfts.setTextColor(TFT_YELLOW, TFT_BLACK);
-  tfts.print("MQTT start...");
-  Serial.println("\nMQTT start...");
-  MQTTStart(false);
-  tfts.println("Done!");
-  Serial.println("MQTT start Done!");
-  tfts.setTextColor(TFT_WHITE, TFT_BLACK);
-#endif
-
-#ifdef GEOLOCATION_ENABLED
-  tfts.setTextColor(TFT_CYAN, TFT_BLACK);
-  tfts.println("GeoLoc query...");
-  if (GetGeoLocationTimeZoneOffset())
+  if (!fast_boot)
   {
-    tfts.print("TZ: ");
-    Serial.print("TZ: ");
-    tfts.println(GeoLocTZoffset);
-    Serial.println(GeoLocTZoffset);
-    uclock.setTimeZoneOffset(GeoLocTZoffset * 3600);
-    Serial.println();
-    Serial.print("Saving config! Triggered by timezone change...");
-    stored_config.save();
+    // Setup MQTT.
+    tfts.setTextColor(TFT_YELLOW, TFT_BLACK);
+    tfts.print("MQTT start...");
+    Serial.println("\nMQTT start...");
+    loop_profiler.bootPhaseStart(LoopProfiler::boot_mqtt);
+    MQTTStart(false);
+    MQTTStarted = true;
+    loop_profiler.bootPhaseDone(LoopProfiler::boot_mqtt);
     tfts.println("Done!");
-    Serial.println("Done!");
+    Serial.println("MQTT start Done!");
     tfts.setTextColor(TFT_WHITE, TFT_BLACK);
   }
-  else
+#endif
+
+#ifdef GEOLOCATION_ENABLED
+  if (!fast_boot)
   {
-    tfts.setTextColor(TFT_RED, TFT_BLACK);
-    tfts.println("GeoLoc FAILED");
-    Serial.println("GeoLoc failed!");
-    tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+    tfts.setTextColor(TFT_CYAN, TFT_BLACK);
+    tfts.println("GeoLoc query...");
+    loop_profiler.bootPhaseStart(LoopProfiler::boot_geoloc);
+    if (GetGeoLocationTimeZoneOffset())
+    {
+      tfts.print("TZ: ");
+      Serial.print("TZ: ");
+      tfts.println(GeoLocTZoffset);
+      Serial.println(GeoLocTZoffset);
+      uclock.setTimeZoneOffset(GeoLocTZoffset * 3600);
+      Serial.println();
+      Serial.print("Saving config! Triggered by timezone change...");
+      stored_config.save();
+      tfts.println("Done!");
+      Serial.println("Done!");
+      tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+    }
+    else
+    {
+      tfts.setTextColor(TFT_RED, TFT_BLACK);
+      tfts.println("GeoLoc FAILED");
+      Serial.println("GeoLoc failed!");
+      tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+    }
+    loop_profiler.bootPhaseDone(LoopProfiler::boot_geoloc);
   }
 #endif
 
@@ -327,22 +389,30 @@ void setup()
     Serial.println("Last selected index of clock face is less than 1.");
   }
   tfts.current_graphic = uclock.getActiveGraphicIdx();
+  if (!fast_boot)
+    tfts.EnablePrefetchBuffers(); // the network is up (or failed), its RAM is taken
 
-  tfts.setTextColor(TFT_WHITE, TFT_BLACK);
-  tfts.println("Done with Setup!");
   Serial.println("\nDone with Setup!");
-
-  // Leave bootup messages on screen for a few seconds (10x200ms = 2 sec).
-  for (uint8_t ndx = 0; ndx < 10; ndx++)
+  if (!fast_boot)
   {
-    tfts.print(">");
-    delay(200);
+    tfts.setTextColor(TFT_WHITE, TFT_BLACK);
+    tfts.println("Done with Setup!");
+
+    // Leave bootup messages on screen for a few seconds (10x200ms = 2 sec).
+    for (uint8_t ndx = 0; ndx < 10; ndx++)
+    {
+      tfts.print(">");
+      delay(200);
+    }
+    tfts.fillScreen(TFT_BLACK);
   }
 
   // Start up the clock displays.
-  tfts.fillScreen(TFT_BLACK);
+  loop_profiler.bootPhaseStart(LoopProfiler::boot_first_digits);
   uclock.loop();
   updateClockDisplay(TFTs::force); // Draw all the clock digits
+  tfts.WaitForImageTransfer();
+  loop_profiler.bootPhaseDone(LoopProfiler::boot_first_digits);
   Serial.println("Starting main loop...");
 }
 
@@ -352,12 +422,23 @@ void setup()
 void loop()
 {
   uint32_t millis_at_top = millis();
+  loop_profiler.start(LoopProfiler::total);
 
   // Do all the maintenance work.
+  loop_profiler.start(LoopProfiler::wifi);
   WifiReconnect(); // If not connected to WiFi, attempt to reconnect
+  checkBootProgress();
+  loop_profiler.stop(LoopProfiler::wifi);
+
+#ifdef LOOP_PROFILER
+  checkSerialCommands();
+#endif
 
 #if defined(MQTT_PLAIN_ENABLED) || defined(MQTT_HOME_ASSISTANT)
-  MQTTLoopFrequently();
+  loop_profiler.start(LoopProfiler::mqtt);
+  if (MQTTStarted)
+    MQTTLoopFrequently();
+  loop_profiler.stop(LoopProfiler::mqtt);
 
   bool MQTTCommandReceived =
       MQTTCommandMainPowerReceived ||
@@ -395,6 +476,7 @@ void loop()
     }
     else
     {
+      tfts.WaitForImageTransfer();
       tfts.chip_select.setAll();
       tfts.fillScreen(TFT_BLACK); // Blank the screens before turning off; needed for all clocks without a real power switch circuit to "simulate" the switched-off displays
       tfts.disableAllDisplays();
@@ -485,6 +567,13 @@ void loop()
     }
   }
 
+  if (MQTTCommandBackEffectReceived)
+  {
+    MQTTCommandBackEffectReceived = false;
+    if (backlights.setCustomEffect(MQTTCommandBackEffect))
+      backlights.setPattern(Backlights::custom);
+  }
+
   if (MQTTCommandBackColorPhaseReceived)
   {
     MQTTCommandBackColorPhaseReceived = false;
@@ -577,7 +666,9 @@ void loop()
   }
 #endif
 
+  loop_profiler.start(LoopProfiler::buttons);
   buttons.loop();
+  loop_profiler.stop(LoopProfiler::buttons);
 
 #ifdef HARDWARE_NOVELLIFE_CLOCK
   HandleGestureInterupt();
@@ -590,6 +681,7 @@ void loop()
   { // Power button was pressed: if in the menu, exit menu, else turn off displays and backlight.
     if (tfts.isEnabled())
     { // Check if TFT state is enabled and switch OFF the LCDs and LED backlights.
+      tfts.WaitForImageTransfer();
       tfts.chip_select.setAll();
       tfts.fillScreen(TFT_BLACK); // Blank the screens before turning off; needed for all clocks without a real power switch circuit
       tfts.disableAllDisplays();
@@ -608,15 +700,24 @@ void loop()
   }
 #endif // ONE_BUTTON_ONLY_MENU
 
+  loop_profiler.start(LoopProfiler::menu);
   menu.loop(buttons); // Must be called after buttons.loop()
+  loop_profiler.stop(LoopProfiler::menu);
+  loop_profiler.start(LoopProfiler::backlights);
   backlights.loop();
+  loop_profiler.stop(LoopProfiler::backlights);
+  loop_profiler.start(LoopProfiler::clock);
   uclock.loop();
+  loop_profiler.stop(LoopProfiler::clock);
 
 #ifdef DIMMING
   checkDimmingNeeded(); // Night or day time brightness change
 #endif
 
+  loop_profiler.start(LoopProfiler::display);
   updateClockDisplay(); // Draw only the changed clock digits!
+  tfts.RenderTransitions(); // Animated digit changes, if enabled
+  loop_profiler.stop(LoopProfiler::display);
 
 #ifdef GEOLOCATION_ENABLED
   checkUpdateGeoLocNeeded(); // Check if it is time to update geolocation based timezone offset (just once per day)
@@ -630,8 +731,8 @@ void loop()
 
     if (menu_state == Menu::idle)
     {
-      // We just changed into idle, so force a redraw of all clock digits and save the config.
-      updateClockDisplay(TFTs::force); // Redraw everything
+      // We just changed into idle, so remove the menu (the digit below is sent again) and save the config.
+      tfts.hideMenu();
       Serial.println();
       Serial.print("Saving config! Triggered from leaving menu...");
       stored_config.save();
@@ -639,6 +740,10 @@ void loop()
     }
     else
     {
+      char menu_text[48]; // lines separated by '\n', drawn with font 4 - 26 pixel high - on the lower half of the most left display
+      menu_text[0] = '\0';
+      const TFTs::OverlayIcon *menu_icon = nullptr;
+      int8_t menu_progress = -1; // percent, -1 for no progress bar
       // Backlight Pattern
       if (menu_state == Menu::backlight_pattern)
       {
@@ -646,9 +751,7 @@ void loop()
         {
           backlights.setNextPattern(menu_change);
         }
-        setupMenu();
-        tfts.println("Pattern:");
-        tfts.println(backlights.getPatternStr());
+        snprintf(menu_text, sizeof(menu_text), "Pattern:\n%s", backlights.getPatternStr().c_str());
       }
       // Backlight Color
       else if (menu_state == Menu::pattern_color)
@@ -657,9 +760,7 @@ void loop()
         {
           backlights.adjustColorPhase(menu_change * 16);
         }
-        setupMenu();
-        tfts.println("Color:");
-        tfts.printf("%06X\n", backlights.getColor());
+        snprintf(menu_text, sizeof(menu_text), "Color:\n%06X", (unsigned)backlights.getColor());
       }
       // Backlight Intensity
       else if (menu_state == Menu::backlight_intensity)
@@ -668,9 +769,8 @@ void loop()
         {
           backlights.adjustIntensity(menu_change);
         }
-        setupMenu();
-        tfts.println("Intensity:");
-        tfts.println(backlights.getIntensity());
+        snprintf(menu_text, sizeof(menu_text), "Intensity:\n%d", backlights.getIntensity());
+        menu_progress = backlights.getIntensity() * 100 / (backlights.max_intensity - 1);
       }
       // 12 Hour or 24 Hour mode?
       else if (menu_state == Menu::twelve_hour)
@@ -681,9 +781,7 @@ void loop()
           tfts.setDigit(HOURS_TENS, uclock.getHoursTens(), TFTs::force);
           tfts.setDigit(HOURS_ONES, uclock.getHoursOnes(), TFTs::force);
         }
-        setupMenu();
-        tfts.println("Hour format");
-        tfts.println(uclock.getTwelveHour() ? "12 hour" : "24 hour");
+        snprintf(menu_text, sizeof(menu_text), "Hour format\n%s", uclock.getTwelveHour() ? "12 hour" : "24 hour");
       }
       // Blank leading zeros on the hours?
       else if (menu_state == Menu::blank_hours_zero)
@@ -693,9 +791,7 @@ void loop()
           uclock.toggleBlankHoursZero();
           tfts.setDigit(HOURS_TENS, uclock.getHoursTens(), TFTs::force);
         }
-        setupMenu();
-        tfts.println("Blank zero?");
-        tfts.println(uclock.getBlankHoursZero() ? "yes" : "no");
+        snprintf(menu_text, sizeof(menu_text), "Blank zero?\n%s", uclock.getBlankHoursZero() ? "yes" : "no");
       }
       // UTC Offset, hours
       else if (menu_state == Menu::utc_offset_hour)
@@ -723,15 +819,12 @@ void loop()
           }
 
           uclock.setTimeZoneOffset(newOffset); // set the new offset
-          uclock.loop();                       // update the clock time and redraw the changed digits -> will "flicker" the menu for a short time, but without, menu is not redrawn correctly
+          uclock.loop();                       // update the clock time and redraw the changed digits, under the menu
 #ifdef DIMMING
           checkDimmingNeeded(); // check if we need dimming for the night, because timezone was changed
 #endif
           currOffset = uclock.getTimeZoneOffset(); // get the new offset as current offset for the menu
         }
-        setupMenu();
-        tfts.println("UTC Offset");
-        tfts.println(" +/- Hour");
         char offsetStr[11];
         int8_t offset_hour = currOffset / 3600;
         int8_t offset_min = (currOffset % 3600) / 60;
@@ -752,7 +845,7 @@ void loop()
         { // we don't want a sign in front of the 0:00 case
           snprintf(offsetStr, sizeof(offsetStr), "%d:%02d", offset_hour, offset_min);
         }
-        tfts.println(offsetStr);
+        snprintf(menu_text, sizeof(menu_text), "UTC Offset\n +/- Hour\n%s", offsetStr);
       } // END UTC Offset, hours
       // BEGIN UTC Offset, 15 minutes
       else if (menu_state == Menu::utc_offset_15m)
@@ -778,15 +871,12 @@ void loop()
           }
 
           uclock.setTimeZoneOffset(newOffset); // set the new offset
-          uclock.loop();                       // update the clock time and redraw the changed digits -> will "flicker" the menu for a short time, but without, menu is not redrawn correctly
+          uclock.loop();                       // update the clock time and redraw the changed digits, under the menu
 #ifdef DIMMING
           checkDimmingNeeded(); // check if we need dimming for the night, because timezone was changed
 #endif
           currOffset = uclock.getTimeZoneOffset(); // get the new offset as current offset for the menu
         }
-        setupMenu();
-        tfts.println("UTC Offset");
-        tfts.println(" +/- 15m");
         char offsetStr[11];
         int8_t offset_hour = currOffset / 3600;
         int8_t offset_min = (currOffset % 3600) / 60;
@@ -807,7 +897,7 @@ void loop()
         { // we don't want a sign in front of the 0:00 case so overwrite the string
           snprintf(offsetStr, sizeof(offsetStr), "%d:%02d", offset_hour, offset_min);
         }
-        tfts.println(offsetStr);
+        snprintf(menu_text, sizeof(menu_text), "UTC Offset\n +/- 15m\n%s", offsetStr);
       } // END UTC Offset, 15 minutes
       // select clock face
       else if (menu_state == Menu::selected_graphic)
@@ -822,10 +912,7 @@ void loop()
             updateClockDisplay(TFTs::force); // Redraw everything
           }
         }
-        setupMenu();
-        tfts.println("Selected");
-        tfts.println("graphic:");
-        tfts.printf("    %d\n", uclock.getActiveGraphicIdx());
+        snprintf(menu_text, sizeof(menu_text), "Selected\ngraphic:\n    %d", uclock.getActiveGraphicIdx());
       }
 #ifdef WIFI_USE_WPS //  WPS code
       // connect to WiFi using wps pushbutton mode
@@ -841,13 +928,14 @@ void loop()
             tfts.setTextColor(TFT_WHITE, TFT_BLACK);
             tfts.setCursor(0, 0, 4); // Font 4. 26 pixel high
             WiFiStartWps();
+            updateClockDisplay(TFTs::force); // the WPS messages were drawn over all displays
           }
         }
-        setupMenu();
-        tfts.println("Connect to WiFi?");
-        tfts.println("Left=WPS");
+        snprintf(menu_text, sizeof(menu_text), "Connect to WiFi?\nLeft=WPS");
+        menu_icon = &TFTs::icon_wifi;
       }
 #endif
+      tfts.showMenu(menu_text, menu_icon, menu_progress); // sends only the rows that changed
     }
   } // if (menu.stateChanged())
 
@@ -855,27 +943,43 @@ void loop()
   if (time_in_loop < 20)
   {
     // we have free time (loop run took under 20 ms), spend it for loading next image into buffer
+    loop_profiler.start(LoopProfiler::load_image);
     tfts.LoadNextImage();
+    loop_profiler.stop(LoopProfiler::load_image);
 
     // Do we still have extra time? -> normally not in the same loop where image loading was done, but in the next loops
     time_in_loop = millis() - millis_at_top;
     if (time_in_loop < 20)
     {
+      loop_profiler.start(LoopProfiler::free_time);
+      if (Clock::isConfigSavePending())
+      { // the RTC was set or its drift learned
+        Serial.print("Saving config! Triggered by the RTC sync...");
+        stored_config.save();
+        Clock::configSaved();
+        Serial.println(" Done.");
+      }
+
 #if defined(MQTT_PLAIN_ENABLED) || defined(MQTT_HOME_ASSISTANT)
-      MQTTLoopInFreeTime(); // do less time critical MQTT tasks
+      if (MQTTStarted)
+        MQTTLoopInFreeTime(); // do less time critical MQTT tasks
 #endif
 
 #ifdef GEOLOCATION_ENABLED
       processGeoLocUpdate();
 #endif // GEOLOCATION_ENABLED
-      // Sleep for up to 20ms, less if we've spent time doing stuff above.
+      loop_profiler.stop(LoopProfiler::free_time);
       time_in_loop = millis() - millis_at_top;
-      if (time_in_loop < 20) // loop was faster than 20ms -> unusually fast, yield some time to other tasks
-      {
-        delay(20 - time_in_loop);
-      }
     }
   }
+  loop_profiler.stop(LoopProfiler::total); // work done in this loop, without the sleep below
+
+  // Sleep for up to 20ms, less if we've spent time doing stuff above.
+  if (time_in_loop < 20) // loop was faster than 20ms -> unusually fast, yield some time to other tasks
+  {
+    // Wake up when the next second begins, so the digits change on time. At least 1 ms, the loop must always yield.
+    uclock.idle(max<uint32_t>(1, min<uint32_t>(20 - time_in_loop, uclock.getMillisToNextSecond())));
+  }
 #ifdef DEBUG_OUTPUT
   if (time_in_loop <= 2) // if the loop time is less than 2ms, we don't need to print it in detail
     Serial.print(".");
@@ -887,13 +991,47 @@ void loop()
 #endif // DEBUG_OUTPUT
 }
 
-void setupMenu()
-{                                  // Prepare drawing of the menu texts
-  tfts.chip_select.setHoursTens(); // use most left display
-  tfts.setTextColor(TFT_WHITE, TFT_BLACK);
-  tfts.fillRect(0, 120, 135, 120, TFT_BLACK); // use lower half of the display, fill with black
-  tfts.setCursor(0, 124, 4);                  // use font 4 - 26 pixel high - for the menu text
+#ifdef LOOP_PROFILER
+// Commands on the serial interface, one per line: "diag" shows the loop profile, "diag reset" starts a new min/max window.
+void checkSerialCommands()
+{
+  static char line[16];
+  static uint8_t length = 0;
+  while (Serial.available())
+  {
+    char c = Serial.read();
+    if (c != '\r' && c != '\n')
+    {
+      if (length < sizeof(line) - 1)
+        line[length++] = c;
+      continue;
+    }
+    if (length == 0)
+      continue;
+    line[length] = '\0';
+    length = 0;
+
+    if (strcmp(line, "diag") == 0)
+    {
+      loop_profiler.printReport(Serial);
+      loop_profiler.printBootReport(Serial);
+      Serial.printf("NTP interval %lu min, RTC drift %+.3f ppm from %u NTP syncs%s\n",
+                    (unsigned long)(Clock::getCurrentNtpInterval() / 60000), Clock::getRtcDriftPpb() / 1000.0,
+                    Clock::getRtcDriftSyncs(), Clock::isRtcDriftCalibrated() ? ", calibrated" : "");
+    }
+    else if (strcmp(line, "diag reset") == 0)
+    {
+      loop_profiler.resetWindow();
+      Serial.println("Loop profile min/max reset.");
+    }
+    else
+    {
+      Serial.print("Unknown command: ");
+      Serial.println(line);
+    }
+  }
 }
+#endif // LOOP_PROFILER
 
 #ifdef DIMMING
 bool isNightTime(uint8_t current_hour)
@@ -920,6 +1058,7 @@ void checkDimmingNeeded()
     Serial.print(NIGHT_TIME);
     Serial.print(", Day Time Start = ");
     Serial.println(DAY_TIME);
+    uint8_t old_dimming = tfts.dimming;
     if (isNightTime(current_hour))
     { // check if it is in the defined night time
       Serial.println("Set to night time mode (dimmed)!");
@@ -934,7 +1073,10 @@ void checkDimmingNeeded()
       tfts.ProcessUpdatedDimming();
       backlights.setDimming(false);
     }
-    updateClockDisplay(TFTs::force); // Redraw everything; software dimming will be done here
+    if (tfts.dimming != old_dimming)
+    {
+      updateClockDisplay(TFTs::force); // Redraw everything; software dimming will be done here
+    }
     hour_old = current_hour;
   }
 }
@@ -1075,6 +1217,13 @@ void processGeoLocUpdate()
   Serial.println("Querying GeoLocation API...");
   if (GetGeoLocationTimeZoneOffset())
   {
+    if (uclock.getTimeZoneOffset() != GeoLocTZoffset * 3600)
+    {
+      uclock.setTimeZoneOffset(GeoLocTZoffset * 3600);
+      Serial.print("Saving config! Triggered by timezone change...");
+      stored_config.save();
+      Serial.println(" Done.");
+    }
     const int32_t GeoLocTOffsetNew = uclock.getTimeZoneOffset() / 3600;
     Serial.print("New TZ offset (hours): ");
     Serial.println(GeoLocTOffsetNew);
@@ -1102,13 +1251,78 @@ void processGeoLocUpdate()
 }
 #endif // GEOLOCATION_ENABLED
 
+// Ends the boot phases which finish in loop(). With FAST_BOOT, it also starts what needs the network once WiFi is
+// connected: NTP, then MQTT, then geolocation, one step per loop so the clock keeps running in between.
+void checkBootProgress()
+{
+  static bool boot_complete = false;
+  if (boot_complete || WifiState != connected)
+    return; // everything left needs the network
+
+  if (!loop_profiler.isBootPhaseDone(LoopProfiler::boot_wifi))
+    loop_profiler.bootPhaseDone(LoopProfiler::boot_wifi);
+
+  if (!loop_profiler.isBootPhaseStarted(LoopProfiler::boot_ntp))
+  { // FAST_BOOT: the clock ran on the RTC time until now
+    loop_profiler.bootPhaseStart(LoopProfiler::boot_ntp);
+    Clock::requestNtpSync();
+    return;
+  }
+  if (!loop_profiler.isBootPhaseDone(LoopProfiler::boot_ntp) && Clock::isNtpSynced())
+    loop_profiler.bootPhaseDone(LoopProfiler::boot_ntp);
+
+#if defined(MQTT_PLAIN_ENABLED) || defined(MQTT_HOME_ASSISTANT)
+  if (!MQTTStarted)
+  {
+    Serial.println("\nMQTT start...");
+    loop_profiler.bootPhaseStart(LoopProfiler::boot_mqtt);
+    MQTTStart(false);
+    MQTTStarted = true;
+    loop_profiler.bootPhaseDone(LoopProfiler::boot_mqtt);
+    return;
+  }
+#endif
+
+#ifdef GEOLOCATION_ENABLED
+  if (!loop_profiler.isBootPhaseStarted(LoopProfiler::boot_geoloc))
+  { // queried in free time by processGeoLocUpdate(), with its retries
+    loop_profiler.bootPhaseStart(LoopProfiler::boot_geoloc);
+    GeoLocNeedsUpdate = true;
+    GeoLocFailedAttempts = 0;
+    GeoLocNextRetryMillis = 0;
+    GeoLocAttemptDay = uclock.getDay();
+    return;
+  }
+  if (!loop_profiler.isBootPhaseDone(LoopProfiler::boot_geoloc))
+  {
+    if (GeoLocNeedsUpdate)
+      return;
+    loop_profiler.bootPhaseDone(LoopProfiler::boot_geoloc);
+  }
+#endif
+
+  if (loop_profiler.isBootPhaseDone(LoopProfiler::boot_ntp))
+  {
+    boot_complete = true;
+    tfts.EnablePrefetchBuffers(); // FAST_BOOT: MQTT and geolocation have their RAM now
+    loop_profiler.printBootReport(Serial);
+  }
+}
+
 void updateClockDisplay(TFTs::show_t show)
 {
-  // Refresh, starting with seconds.
-  tfts.setDigit(SECONDS_ONES, uclock.getSecondsOnes(), show);
-  tfts.setDigit(SECONDS_TENS, uclock.getSecondsTens(), show);
-  tfts.setDigit(MINUTES_ONES, uclock.getMinutesOnes(), show);
-  tfts.setDigit(MINUTES_TENS, uclock.getMinutesTens(), show);
-  tfts.setDigit(HOURS_ONES, uclock.getHoursOnes(), show);
-  tfts.setDigit(HOURS_TENS, uclock.getHoursTens(), show);
+  // Refresh, starting with seconds. Digits with the same value are sent together.
+  uint8_t values[NUM_DIGITS];
+  values[SECONDS_ONES] = uclock.getSecondsOnes();
+  values[SECONDS_TENS] = uclock.getSecondsTens();
+  values[MINUTES_ONES] = uclock.getMinutesOnes();
+  values[MINUTES_TENS] = uclock.getMinutesTens();
+  values[HOURS_ONES] = uclock.getHoursOnes();
+  values[HOURS_TENS] = uclock.getHoursTens();
+  tfts.setDigits(values, show);
+
+  // Digits changing at the next second are loaded in free time, see TFTs::LoadNextImage().
+  uint8_t next_digits[NUM_DIGITS];
+  uclock.getNextSecondDigits(next_digits);
+  tfts.PlanPrefetch(next_digits, uclock.getMillisToNextSecond());
 }
@@ -1,9 +1,111 @@
 #!/usr/bin/python3
 
 import os
+import struct
 from PIL import Image
 
-def convert_bmp_to_clk(input_folder, output_folder="clk"):
+# CLK file formats. All values little endian.
+#
+# Version 1 (header "CK"):
+#   "CK", u16 width, u16 height, then width * height RGB565 pixels, row by row, top row first.
+#
+# Version 2 (header "C2"):
+#   "C2", u8 version (2), u8 compression, u16 width, u16 height, u32 reserved (0),
+#   u32 file offset of each row (height entries), then the rows back to back.
+#   Compression 0: each row is width raw RGB565 pixels.
+#   Compression 1: each row is a sequence of RLE packets. A header byte with bit 7 set is a run:
+#   the following pixel is repeated (header & 0x7F) + 1 times. Otherwise (header + 1) literal pixels follow.
+#   Packets never cross a row boundary.
+#   Compression 2: after the row offsets, u16 number of colors (up to 256) and the palette of RGB565 colors. Each row
+#   is width palette indexes, one byte per pixel. Half the size of compression 0, and the glyph cache of the firmware
+#   keeps the digits in the same form.
+
+CLK_V2_HEADER_SIZE = 12
+COMPRESSION_NONE = 0
+COMPRESSION_RLE = 1
+COMPRESSION_PALETTE = 2
+
+
+def rgb_to_rgb565(R, G, B):
+    return ((R & 0xF8) << 8) | ((G & 0xFC) << 3) | (B >> 3)
+
+
+def rle_encode_row(row):
+    out = bytearray()
+    literal = []
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:128]
+            del literal[:128]
+            out.append(len(chunk) - 1)
+            for pixel in chunk:
+                out.extend(pixel.to_bytes(2, "little"))
+
+    x = 0
+    while x < len(row):
+        run = 1
+        while x + run < len(row) and row[x + run] == row[x] and run < 128:
+            run += 1
+        if run >= 2:
+            flush_literal()
+            out.append(0x80 | (run - 1))
+            out += row[x].to_bytes(2, "little")
+        else:
+            literal.append(row[x])
+        x += run
+    flush_literal()
+    return bytes(out)
+
+
+def encode_clk_v1(W, H, rows):
+    data = bytearray(b"CK")
+    data += struct.pack("<HH", W, H)
+    for row in rows:
+        for pixel in row:
+            data += pixel.to_bytes(2, "little")
+    return bytes(data)
+
+
+def make_palette(rows):
+    palette = []
+    index = {}
+    for row in rows:
+        for pixel in row:
+            if pixel not in index:
+                index[pixel] = len(palette)
+                palette.append(pixel)
+    return palette, index
+
+
+def encode_clk_v2(W, H, rows, compression=COMPRESSION_RLE):
+    palette_data = b""
+    if compression == COMPRESSION_PALETTE:
+        palette, index = make_palette(rows)
+        if len(palette) > 256:
+            print(f"  {len(palette)} colors, too many for a palette. Using RLE compression.")
+            compression = COMPRESSION_RLE
+        else:
+            palette_data = struct.pack("<H", len(palette)) + b"".join(c.to_bytes(2, "little") for c in palette)
+            encoded_rows = [bytes(index[pixel] for pixel in row) for row in rows]
+    if compression == COMPRESSION_RLE:
+        encoded_rows = [rle_encode_row(row) for row in rows]
+    elif compression == COMPRESSION_NONE:
+        encoded_rows = [b"".join(pixel.to_bytes(2, "little") for pixel in row) for row in rows]
+
+    data = bytearray(b"C2")
+    data += struct.pack("<BBHHI", 2, compression, W, H, 0)
+    offset = CLK_V2_HEADER_SIZE + 4 * H + len(palette_data)
+    for encoded in encoded_rows:
+        data += struct.pack("<I", offset)
+        offset += len(encoded)
+    data += palette_data
+    for encoded in encoded_rows:
+        data += encoded
+    return bytes(data)
+
+
+def convert_bmp_to_clk(input_folder, output_folder="clk", version=2, compression=COMPRESSION_RLE):
     # Create output folder if missing
     os.makedirs(output_folder, exist_ok=True)
 
@@ -25,29 +127,18 @@ def convert_bmp_to_clk(input_folder, output_folder="clk"):
         W, H = img.size
         pixels = img.load()
 
-        # Open output file
-        with open(clk_path, "wb") as fout:
-            # Write header (6 bytes)
-            fout.write(b"C")
-            fout.write(b"K")
-            fout.write(W.to_bytes(2, "little"))
-            fout.write(H.to_bytes(2, "little"))
-
-            # Write pixel data in RGB565
-            for y in range(H):
-                for x in range(W):
-                    R, G, B = pixels[x, y]
+        # Convert RGB888 → RGB565
+        rows = [[rgb_to_rgb565(*pixels[x, y]) for x in range(W)] for y in range(H)]
 
-                    # Convert RGB888 → RGB565
-                    out_pixel = (
-                        ((R & 0xF8) << 8) |
-                        ((G & 0xFC) << 3) |
-                        (B >> 3)
-                    )
+        if version == 1:
+            data = encode_clk_v1(W, H, rows)
+        else:
+            data = encode_clk_v2(W, H, rows, compression)
 
-                    fout.write(out_pixel.to_bytes(2, "little"))
+        with open(clk_path, "wb") as fout:
+            fout.write(data)
 
-        print(f"Saved: {clk_path}")
+        print(f"Saved: {clk_path} ({len(data)} bytes, raw {W * H * 2})")
 
     print("\nDone!")
 
@@ -58,8 +149,13 @@ if __name__ == "__main__":
     parser = argparse.ArgumentParser(description="Convert BMP files to .clk format")
     parser.add_argument("folder", help="Input folder containing .bmp images")
     parser.add_argument("--out", default="clk", help="Output folder for .clk files")
+    parser.add_argument("--version", type=int, choices=[1, 2], default=2,
+                        help="CLK format version. 1 = raw pixels, readable by all firmware versions. Default: 2")
+    parser.add_argument("--compression", choices=["none", "rle", "palette"], default="rle",
+                        help="Compression of CLK version 2 files. palette needs firmware with palette support, "
+                             "images with more than 256 colors get rle. Default: rle")
 
     args = parser.parse_args()
 
-    convert_bmp_to_clk(args.folder, args.out)
-
+    compressions = {"none": COMPRESSION_NONE, "rle": COMPRESSION_RLE, "palette": COMPRESSION_PALETTE}
+    convert_bmp_to_clk(args.folder, args.out, args.version, compressions[args.compression])
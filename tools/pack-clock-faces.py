@@ -0,0 +1,70 @@
+#!/usr/bin/python3
+
+import os
+import struct
+
+# Clock face pack: all clock face images in a single file, so the firmware opens one file at boot
+# and afterwards only seeks inside it. All values little endian.
+#
+#   "CFPK", u8 version (1), u8 number of faces, u16 reserved (0),
+#   faces * 10 index entries: u32 offset (from the start of the pack), u32 size. Entry (face - 1) * 10 + digit.
+#   Then the image files, unchanged (.bmp or .clk, whatever the firmware is built for).
+#   Size 0 marks a missing image.
+#
+# Faces are numbered from 1, like the files: face 1 is 10.bmp ... 19.bmp, face 2 is 20.bmp ... 29.bmp, etc.
+# Faces are counted from 1 up to the first face without a "0" image, same as the firmware does for loose files.
+
+PACK_MAGIC = b"CFPK"
+PACK_VERSION = 1
+PACK_HEADER_SIZE = 8
+MAX_CLOCK_FACES = 24  # must match MAX_CLOCK_FACES in include/GLOBAL_DEFINES.h
+
+
+def build_pack(input_folder, ext="bmp"):
+    faces = 0
+    while faces < MAX_CLOCK_FACES and os.path.isfile(os.path.join(input_folder, f"{(faces + 1) * 10}.{ext}")):
+        faces += 1
+    if faces == 0:
+        return None, 0
+
+    index = []
+    payload = bytearray()
+    offset = PACK_HEADER_SIZE + faces * 10 * 8
+    for face in range(1, faces + 1):
+        for digit in range(10):
+            path = os.path.join(input_folder, f"{face * 10 + digit}.{ext}")
+            if not os.path.isfile(path):
+                print(f"Missing: {path}")
+                index.append((0, 0))
+                continue
+            with open(path, "rb") as fin:
+                data = fin.read()
+            index.append((offset + len(payload), len(data)))
+            payload += data
+
+    pack = bytearray(PACK_MAGIC)
+    pack += struct.pack("<BBH", PACK_VERSION, faces, 0)
+    for entry in index:
+        pack += struct.pack("<II", *entry)
+    pack += payload
+    return bytes(pack), faces
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser(description="Pack all clock face images into one file")
+    parser.add_argument("folder", help="Folder with the numbered images (10.bmp, 11.bmp, ...)")
+    parser.add_argument("--ext", choices=["bmp", "clk"], default="bmp",
+                        help="Image type to pack, must match the firmware build (USE_CLK_FILES). Default: bmp")
+    parser.add_argument("--out", default="clockfaces.pak", help="Output file. Default: clockfaces.pak")
+
+    args = parser.parse_args()
+
+    data, faces = build_pack(args.folder, args.ext)
+    if data is None:
+        print(f"No .{args.ext} clock faces found.")
+    else:
+        with open(args.out, "wb") as fout:
+            fout.write(data)
+        print(f"Saved: {args.out} ({faces} faces, {len(data)} bytes)")